@@ -1,10 +1,28 @@
 #include "BatchOptimizer.h"
 #include "Optimizer.h"
+#include "Tracer3D.h"
+#include "Parallel.h"
+#include "ResultCache.h"
+#include "SpotAnalysis.h"
+#include "DampedLeastSquares.h"
+#include "ParameterSweep.h"
+#include "Prefilter.h"
+#include "Surrogate.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_set>
+#include <unordered_map>
+#include <array>
+#include <random>
+#include <set>
+#include <cstdio>
 
 std::vector<std::string> BatchOptimizer::splitString(const std::string& str, char delimiter) {
     std::vector<std::string> tokens;
@@ -93,31 +111,8 @@ std::vector<OpticalConfig> BatchOptimizer::loadResultsFromCSV(const std::string&
             continue;  // Skip header
         }
         
-        std::vector<std::string> tokens = splitString(line, ',');
-        // Rank,Score,CameraHits,HitPercentage,RMSSpotSize,BestSecondaryX,BestSecondaryY,
-        // PrimaryDiameter,SecondaryDiameter,PrimaryR,SecondaryR,PrimaryF,SecondaryF,
-        // PrimaryK,SecondaryK,MirrorSeparation,SystemFocalLength,OriginalRowIndex
-        if (tokens.size() >= 18) {
-            OpticalConfig config;
-            // Skip rank (tokens[0])
-            config.score = stringToFloat(tokens[1]);
-            config.cameraHits = static_cast<int>(stringToFloat(tokens[2]));
-            config.hitPercentage = stringToFloat(tokens[3]);
-            config.rmsSpotSize = stringToFloat(tokens[4]);
-            config.bestSecondaryX = stringToFloat(tokens[5]);
-            config.bestSecondaryY = stringToFloat(tokens[6]);
-            config.primaryDiameter = stringToFloat(tokens[7]);
-            config.secondaryDiameter = stringToFloat(tokens[8]);
-            config.primaryR = stringToFloat(tokens[9]);
-            config.secondaryR = stringToFloat(tokens[10]);
-            config.primaryF = stringToFloat(tokens[11]);
-            config.secondaryF = stringToFloat(tokens[12]);
-            config.primaryK = stringToFloat(tokens[13]);
-            config.secondaryK = stringToFloat(tokens[14]);
-            config.mirrorSeparation = stringToFloat(tokens[15]);
-            config.systemFocalLength = stringToFloat(tokens[16]);
-            config.rowIndex = static_cast<int>(stringToFloat(tokens[17]));
-            
+        OpticalConfig config;
+        if (parseResultRow(line, config)) {
             configs.push_back(config);
         }
     }
@@ -127,32 +122,53 @@ std::vector<OpticalConfig> BatchOptimizer::loadResultsFromCSV(const std::string&
     return configs;
 }
 
-BatchResult BatchOptimizer::evaluateConfig(
-    const OpticalConfig& config,
-    CameraSensor* camera,
-    int numRays,
-    float rayStartX,
-    float rayYMin,
-    float rayYMax,
-    int maxBounces
-) {
-    BatchResult result;
-    result.config = config;
-    result.cameraHits = 0;
-    result.hitPercentage = 0.0f;
-    result.rmsSpotSize = 0.0f;
-    result.bestSecondaryX = 0.0f;
-    result.bestSecondaryY = 0.0f;
-    result.score = 0.0f;
+bool BatchOptimizer::parseResultRow(const std::string& line, OpticalConfig& config) {
+    std::vector<std::string> tokens = splitString(line, ',');
+    // Rank,Score,CameraHits,HitPercentage,RMSSpotSize,BestSecondaryX,BestSecondaryY,
+    // PrimaryDiameter,SecondaryDiameter,PrimaryR,SecondaryR,PrimaryF,SecondaryF,
+    // PrimaryK,SecondaryK,MirrorSeparation,SystemFocalLength,OriginalRowIndex
+    // [,ScoreError,RMSError,EE50um,EE80um]
+    if (tokens.size() < 18) {
+        return false;
+    }
     
-    // Create mirrors based on configuration
-    std::vector<std::unique_ptr<Mirror>> mirrors;
+    // Skip rank (tokens[0])
+    config.score = stringToFloat(tokens[1]);
+    config.cameraHits = static_cast<int>(stringToFloat(tokens[2]));
+    config.hitPercentage = stringToFloat(tokens[3]);
+    config.rmsSpotSize = stringToFloat(tokens[4]);
+    config.bestSecondaryX = stringToFloat(tokens[5]);
+    config.bestSecondaryY = stringToFloat(tokens[6]);
+    config.primaryDiameter = stringToFloat(tokens[7]);
+    config.secondaryDiameter = stringToFloat(tokens[8]);
+    config.primaryR = stringToFloat(tokens[9]);
+    config.secondaryR = stringToFloat(tokens[10]);
+    config.primaryF = stringToFloat(tokens[11]);
+    config.secondaryF = stringToFloat(tokens[12]);
+    config.primaryK = stringToFloat(tokens[13]);
+    config.secondaryK = stringToFloat(tokens[14]);
+    config.mirrorSeparation = stringToFloat(tokens[15]);
+    config.systemFocalLength = stringToFloat(tokens[16]);
+    // Exactly, not through a float: merges dedupe and break ties on it
+    try {
+        long long rowIndex = std::stoll(tokens[17]);
+        if (rowIndex < 0 || rowIndex > std::numeric_limits<int>::max()) return false;
+        config.rowIndex = static_cast<int>(rowIndex);
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+void BatchOptimizer::buildSystem(const OpticalConfig& config,
+                                 std::vector<std::unique_ptr<Mirror>>& mirrors) {
+    mirrors.clear();
     
     // Primary parabolic mirror
     float primaryYMax = config.primaryDiameter / 2.0f;
     float primaryYMin = -primaryYMax;
-    float primaryCenterX = 500.0f;  // Fixed position
-    float holeRadius = config.secondaryDiameter / 2.0f + 5.0f;  // Slightly larger than secondary
+    float primaryCenterX = PRIMARY_CENTER_X;
+    float holeRadius = config.secondaryDiameter / 2.0f + HOLE_MARGIN;  // Slightly larger than secondary
     
     auto primary = std::make_unique<ParabolicMirror>(
         config.primaryF,
@@ -172,7 +188,7 @@ BatchResult BatchOptimizer::evaluateConfig(
     float secondaryYMin = -secondaryYMax;
     
     // Initial position: in front of primary focal point
-    float initialSecondaryX = primaryCenterX - config.primaryF + config.mirrorSeparation;
+    float initialSecondaryX = nominalSecondaryX(config);
     
     auto secondary = std::make_unique<HyperbolicMirror>(
         initialSecondaryX,
@@ -187,6 +203,96 @@ BatchResult BatchOptimizer::evaluateConfig(
     
     mirrors.push_back(std::move(primary));
     mirrors.push_back(std::move(secondary));
+}
+
+namespace {
+
+// The parameters evaluateConfig uses, slowest-varying first in a sweep
+const int DESIGN_PARAMETERS = RBFSurrogate::DIMS;
+
+float designParameter(const OpticalConfig& c, int f) {
+    switch (f) {
+        case 0: return c.primaryDiameter;
+        case 1: return c.secondaryDiameter;
+        case 2: return c.primaryF;
+        case 3: return c.secondaryR;
+        case 4: return c.secondaryK;
+        default: return c.mirrorSeparation;
+    }
+}
+
+}  // namespace
+
+float BatchOptimizer::nominalSecondaryX(const OpticalConfig& config) {
+    return PRIMARY_CENTER_X - config.primaryF + config.mirrorSeparation;
+}
+
+void BatchOptimizer::localityOrder(const std::vector<OpticalConfig>& configs, std::vector<int>& rows) {
+    const int FIELDS = DESIGN_PARAMETERS;
+    auto field = [&configs](int row, int f) { return designParameter(configs[row], f); };
+    
+    // Each row's digits: the rank of its value among the distinct values
+    // of that field. A digit runs backwards whenever the traversal position
+    // of the digits before it is odd (only its parity is tracked).
+    size_t n = rows.size();
+    std::vector<std::array<int, FIELDS>> digits(n);
+    std::vector<float> values;
+    std::vector<int> parity(n, 0);
+    for (int f = 0; f < FIELDS; f++) {
+        values.clear();
+        for (int row : rows) values.push_back(field(row, f));
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        int radix = static_cast<int>(values.size());
+        
+        for (size_t i = 0; i < n; i++) {
+            int d = static_cast<int>(std::lower_bound(values.begin(), values.end(), field(rows[i], f)) -
+                                     values.begin());
+            if (parity[i]) d = radix - 1 - d;
+            digits[i][f] = d;
+            parity[i] = (parity[i] * (radix & 1) + d) & 1;
+        }
+    }
+    
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&digits](size_t a, size_t b) { return digits[a] < digits[b]; });
+    std::vector<int> sorted(n);
+    for (size_t i = 0; i < n; i++) sorted[i] = rows[order[i]];
+    rows.swap(sorted);
+}
+
+BatchResult BatchOptimizer::evaluateConfig(
+    const OpticalConfig& config,
+    CameraSensor* camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    const TraceOptions& options,
+    const WarmStart* warmStart
+) {
+    BatchResult result;
+    result.config = config;
+    result.cameraHits = 0;
+    result.hitPercentage = 0.0f;
+    result.rmsSpotSize = 0.0f;
+    result.bestSecondaryX = 0.0f;
+    result.bestSecondaryY = 0.0f;
+    result.score = 0.0f;
+    result.rmsError = 0.0f;
+    result.scoreError = 0.0f;
+    result.raysTraced = 0;
+    // The field evaluation has no encircled-energy metric: mark the radii
+    // as not computed (NaN) rather than 0, and the CSV leaves them empty
+    result.ee50 = options.fields.empty() ? 0.0f : std::numeric_limits<float>::quiet_NaN();
+    result.ee80 = result.ee50;
+    
+    // Create mirrors based on configuration
+    std::vector<std::unique_ptr<Mirror>> mirrors;
+    buildSystem(config, mirrors);
     
     // Run quick optimization to find best secondary position
     HyperbolicMirror* secondaryPtr = dynamic_cast<HyperbolicMirror*>(mirrors[1].get());
@@ -194,83 +300,230 @@ BatchResult BatchOptimizer::evaluateConfig(
     if (!secondaryPtr || !camera) {
         return result;
     }
+    float initialSecondaryX = secondaryPtr->centerX;
     
     // Scan range around initial position
-    float scanXMin = initialSecondaryX - 50.0f;
-    float scanXMax = initialSecondaryX + 50.0f;
+    float scanXMin = initialSecondaryX - SCAN_HALF_RANGE;
+    float scanXMax = initialSecondaryX + SCAN_HALF_RANGE;
     float scanXStep = 2.0f;
     
     int bestHits = 0;
     float bestX = initialSecondaryX;
     float bestY = 0.0f;
     float bestRMS = 100000.0f;
+    float bestRMSError = 0.0f;
+    
+    // Ranking metric after hits: the RMS itself, or EE80 from the pixel grid.
+    // The running RMS bound only prunes on hits when ranking by EE80.
+    bool rankByEE = options.objective == SpotObjective::EE80 && options.fields.empty();
+    float bestMetric = 100000.0f;
+    SpotScratch spotScratch;
+    SpotMetrics spotMetrics;
+    
+    // 3-D mode samples the clear annulus of the primary once and shares
+    // it across every scan position and field
+    const ParabolicMirror* primaryPtr = dynamic_cast<ParabolicMirror*>(mirrors[0].get());
+    PupilSamples pupil;
+    std::vector<float> heights;
+    if (options.trace3D) {
+        float pupilRadius = std::max(std::abs(rayYMin), std::abs(rayYMax));
+        pupil = PupilSampler::sampleAnnulus(options.sampler, numRays,
+                                            primaryPtr->holeRadius, pupilRadius);
+    } else {
+        heights = PupilSampler::sampleFan(options.sampler, numRays, rayYMin, rayYMax,
+                                          primaryPtr->holeRadius);
+    }
+    
+    // On-axis 2-D fans through a system symmetric about the axis only need
+    // their upper half traced; the lower half is its mirror image
+    std::vector<int> weights;
+    if (options.exploitSymmetry && !options.trace3D && options.fields.empty() &&
+        TelescopeOptimizer::isAxiallySymmetric(mirrors, camera)) {
+        std::vector<float> halfHeights;
+        if (TelescopeOptimizer::foldSymmetricFan(heights, halfHeights, weights)) {
+            heights.swap(halfHeights);
+        }
+    }
+    if (options.earlyTermination) {
+        PupilSampler::interleave(heights, weights);
+        PupilSampler::interleave(pupil);
+    }
+    
+    const int CHUNK_3D = 1024;
+    RayBundle3D bundle;
+    SpotDiagram spot;
     
+    std::vector<float> grid;
     for (float x = scanXMin; x <= scanXMax; x += scanXStep) {
+        grid.push_back(x);
+    }
+    
+    // One scan position: trace it and keep it if it beats the incumbent
+    auto scanAt = [&](float x) {
         secondaryPtr->centerX = x;
         secondaryPtr->centerY = 0.0f;
-        camera->clearHits();
         
-        // Trace rays
-        for (int i = 0; i < numRays; i++) {
-            float h = rayYMin + i * (rayYMax - rayYMin) / (numRays - 1);
-            Ray ray(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
+        if (options.trace3D && options.fields.empty()) {
+            // Single on-axis bundle, traced in chunks so a losing position can stop early
+            spot.points.clear();
+            spot.totalRays = 0;
+            spot.blockedRays = 0;
+            EarlyExitBound bound;
+            bool aborted = false;
             
-            // Trace through system
-            for (int bounce = 0; bounce < maxBounces; bounce++) {
-                Intersection closest;
-                Mirror* hitMirror = nullptr;
-                bool isGreenRay = (bounce >= 2);
-                
-                for (auto& mirror : mirrors) {
-                    if (isGreenRay) continue;
-                    Intersection intersection = mirror->intersect(ray);
-                    if (intersection.hit && intersection.distance < closest.distance) {
-                        closest = intersection;
-                        hitMirror = mirror.get();
-                    }
-                }
-                
-                if (camera) {
-                    Intersection cameraHit = camera->intersect(ray);
-                    if (cameraHit.hit && cameraHit.distance < closest.distance) {
-                        closest = cameraHit;
-                        hitMirror = nullptr;
-                    }
-                }
+            for (size_t begin = 0; begin < pupil.size(); begin += CHUNK_3D) {
+                size_t end = std::min(pupil.size(), begin + CHUNK_3D);
+                size_t before = spot.points.size();
+                Tracer3D::traceChunk(*primaryPtr, *secondaryPtr, *camera, pupil, begin, end,
+                                     rayStartX, maxBounces, bundle, spot);
+                result.raysTraced += end - begin;
                 
-                if (closest.hit) {
-                    if (hitMirror == nullptr) {
-                        ray.path.push_back(closest.point);
-                        camera->hitPoints.push_back(closest.point);
-                        break;
-                    }
-                    
-                    if (bounce == 0 && hitMirror->getType() == "hyperbolic") {
-                        ray.bounces = -1;
-                        if (camera) camera->blockedRays++;
-                        break;
-                    }
-                    
-                    ray.reflect(closest.point, closest.normal);
-                } else {
+                for (size_t p = before; p < spot.points.size(); p++) bound.add(spot.points[p]);
+                int remaining = static_cast<int>(pupil.size() - end);
+                if (options.earlyTermination && remaining > 0 &&
+                    bound.cannotBeat(remaining, bestHits, rankByEE ? std::numeric_limits<float>::max() : bestRMS)) {
+                    aborted = true;
                     break;
                 }
             }
+            if (aborted) return;
+            
+            int hits = spot.getHits();
+            float rms = spot.getRMSSpotSize();
+            float metric = rms;
+            if (rankByEE) {
+                spotMetrics = SpotAnalyzer::analyze(spot, *camera, spotScratch);
+                metric = spotMetrics.ee80;
+            }
+            if (hits > bestHits || (hits == bestHits && metric < bestMetric)) {
+                bestHits = hits;
+                bestX = x;
+                bestY = 0.0f;
+                bestRMS = rms;
+                bestMetric = metric;
+                bestRMSError = spot.getRMSStandardError();
+                if (!rankByEE) spotMetrics = SpotAnalyzer::analyze(spot, *camera, spotScratch);
+                result.ee50 = spotMetrics.ee50;
+                result.ee80 = spotMetrics.ee80;
+            }
+            return;
+        }
+        
+        if (options.trace3D || !options.fields.empty()) {
+            FieldEvaluation evaluation;
+            if (options.trace3D) {
+                evaluation = evaluateFields3D(*primaryPtr, *secondaryPtr, *camera, pupil,
+                                              rayStartX, maxBounces, options.fields);
+            } else {
+                evaluation = TelescopeOptimizer::evaluateFields(mirrors, camera, heights,
+                                                                rayStartX, options.fields,
+                                                                maxBounces, options.traceMode);
+            }
             
-            if (ray.bounces >= 0 && camera) {
-                camera->totalRaysTraced++;
+            result.raysTraced += static_cast<long long>(numRays) *
+                                 std::max<size_t>(1, options.fields.anglesArcmin.size());
+            
+            int hits = evaluation.hits;
+            float rms = evaluation.rmsSpotSize;
+            if (hits > bestHits || (hits == bestHits && rms < bestMetric)) {
+                bestHits = hits;
+                bestX = x;
+                bestY = 0.0f;
+                bestRMS = rms;
+                bestMetric = rms;
+                bestRMSError = evaluation.rmsError;
             }
+            return;
+        }
+        
+        camera->clearHits();
+        bool aborted = false;
+        
+        // Branch-and-bound: stop once this position cannot beat the best so far
+        EarlyExitCheck shouldAbort = nullptr;
+        if (options.earlyTermination) {
+            float boundRMS = rankByEE ? std::numeric_limits<float>::max() : bestRMS;
+            shouldAbort = [bestHits, boundRMS](const EarlyExitBound& bound, int remaining) {
+                return bound.cannotBeat(remaining, bestHits, boundRMS);
+            };
         }
         
+        // Trace rays
+        result.raysTraced += TelescopeOptimizer::traceFan(mirrors, camera, heights, weights,
+                                                          rayStartX, maxBounces,
+                                                          shouldAbort, aborted, options.traceMode);
+        if (aborted) return;
+        
         int hits = camera->hitPoints.size();
         float rms = camera->getRMSSpotSize();
+        float metric = rms;
+        if (rankByEE) {
+            spotMetrics = SpotAnalyzer::analyze(*camera, spotScratch);
+            metric = spotMetrics.ee80;
+        }
         
-        // Prefer configurations with more hits, then smaller RMS
-        if (hits > bestHits || (hits == bestHits && rms < bestRMS)) {
+        // Prefer configurations with more hits, then smaller RMS (or EE80)
+        if (hits > bestHits || (hits == bestHits && metric < bestMetric)) {
             bestHits = hits;
             bestX = x;
             bestY = 0.0f;
             bestRMS = rms;
+            bestMetric = metric;
+            bestRMSError = CameraSensor::computeRMSStandardError(camera->hitPoints);
+            if (!rankByEE) spotMetrics = SpotAnalyzer::analyze(*camera, spotScratch);
+            result.ee50 = spotMetrics.ee50;
+            result.ee80 = spotMetrics.ee80;
+        }
+    };
+    
+    if (!warmStart || !warmStart->valid) {
+        std::vector<float> scanPositions = grid;
+        if (options.earlyTermination) {
+            // Visit the nominal position first and work outwards, so a good
+            // incumbent is found early and the bounds can prune the rest
+            std::stable_sort(scanPositions.begin(), scanPositions.end(),
+                             [initialSecondaryX](float a, float b) {
+                                 return std::abs(a - initialSecondaryX) < std::abs(b - initialSecondaryX);
+                             });
+        }
+        for (float x : scanPositions) scanAt(x);
+    } else {
+        // Local search on the same grid about the neighbour's optimum,
+        // widened towards whichever edge the best position lands on
+        int last = static_cast<int>(grid.size()) - 1;
+        std::vector<bool> visited(grid.size(), false);
+        auto visit = [&](int k) {
+            if (visited[k]) return;
+            visited[k] = true;
+            scanAt(grid[k]);
+        };
+        auto indexOf = [&](float x) {
+            return std::clamp(static_cast<int>(std::lround((x - scanXMin) / scanXStep)), 0, last);
+        };
+        
+        int center = indexOf(initialSecondaryX + warmStart->offset);
+        int lo = std::max(0, center - WARM_HALF_WINDOW);
+        int hi = std::min(last, center + WARM_HALF_WINDOW);
+        for (int d = 0; center - d >= lo || center + d <= hi; d++) {
+            if (center - d >= lo) visit(center - d);
+            if (center + d <= hi) visit(center + d);
+        }
+        while (bestHits > 0) {
+            int bestIndex = indexOf(bestX);
+            if (bestIndex == lo && lo > 0) {
+                lo = std::max(0, lo - WARM_HALF_WINDOW);
+                for (int k = bestIndex - 1; k >= lo; k--) visit(k);
+            } else if (bestIndex == hi && hi < last) {
+                hi = std::min(last, hi + WARM_HALF_WINDOW);
+                for (int k = bestIndex + 1; k <= hi; k++) visit(k);
+            } else {
+                break;
+            }
+        }
+        
+        // No light anywhere near the neighbour's optimum: scan the rest cold
+        if (bestHits == 0) {
+            for (int k = 0; k <= last; k++) visit(k);
         }
     }
     
@@ -280,13 +533,257 @@ BatchResult BatchOptimizer::evaluateConfig(
     result.bestSecondaryX = bestX;
     result.bestSecondaryY = bestY;
     
-    // Calculate combined score (higher is better)
-    // Prioritize hit percentage, then minimize RMS spot size
-    result.score = result.hitPercentage * 100.0f - result.rmsSpotSize;
+    result.rmsError = bestRMSError;
+    computeScore(result, numRays, rankByEE);
+    estimateSamplingError(result, mirrors, *camera, numRays, rayStartX, rayYMin, rayYMax,
+                          maxBounces, options);
     
     return result;
 }
 
+void BatchOptimizer::computeScore(BatchResult& result, int numRays, bool rankByEE) {
+    // Calculate combined score (higher is better)
+    // Prioritize hit percentage, then minimize RMS spot size (or EE80)
+    result.score = result.hitPercentage * 100.0f - (rankByEE ? result.ee80 : result.rmsSpotSize);
+    
+    // Sampling error: binomial error of the hit fraction plus the RMS error
+    float hitFraction = static_cast<float>(result.cameraHits) / numRays;
+    float hitFractionError = std::sqrt(hitFraction * (1.0f - hitFraction) / numRays);
+    float metricError = rankByEE ? 0.0f : result.rmsError;  // EE80 is quantised to pixels
+    result.scoreError = std::sqrt(std::pow(hitFractionError * 10000.0f, 2.0f) +
+                                  metricError * metricError);
+}
+
+void BatchOptimizer::estimateSamplingError(
+    BatchResult& result,
+    const std::vector<std::unique_ptr<Mirror>>& mirrors,
+    const CameraSensor& camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    const TraceOptions& options
+) {
+    switch (options.sampler.type) {
+        case SamplerType::StratifiedJitter:
+            // Independent jitter in every stratum: the binomial and
+            // delta-method errors hold (conservatively)
+            return;
+        case SamplerType::Halton:
+        case SamplerType::Sobol:
+            break;
+        default:
+            // The same fan every time: the ranking is exact, there is no
+            // sampling error to report
+            result.rmsError = std::numeric_limits<float>::quiet_NaN();
+            result.scoreError = std::numeric_limits<float>::quiet_NaN();
+            return;
+    }
+    
+    // A QMC sequence is not a set of independent samples, but its random
+    // shifts are independent replicates of the whole estimate
+    const ParabolicMirror* primaryPtr = dynamic_cast<ParabolicMirror*>(mirrors[0].get());
+    HyperbolicMirror* secondaryPtr = dynamic_cast<HyperbolicMirror*>(mirrors[1].get());
+    secondaryPtr->centerX = result.bestSecondaryX;
+    secondaryPtr->centerY = result.bestSecondaryY;
+    bool rankByEE = options.objective == SpotObjective::EE80 && options.fields.empty();
+    
+    CameraSensor sensor = camera;
+    SpotScratch scratch;
+    RayBundle3D bundle;
+    SpotDiagram spot;
+    double scoreSum = result.score, scoreSumSq = static_cast<double>(result.score) * result.score;
+    double rmsSum = result.rmsSpotSize, rmsSumSq = static_cast<double>(result.rmsSpotSize) * result.rmsSpotSize;
+    for (int r = 1; r < RQMC_REPLICATES; r++) {
+        SamplerSettings shifted = options.sampler;
+        shifted.seed = options.sampler.seed + r;
+        
+        BatchResult replicate = result;
+        if (options.trace3D) {
+            float pupilRadius = std::max(std::abs(rayYMin), std::abs(rayYMax));
+            PupilSamples pupil = PupilSampler::sampleAnnulus(shifted, numRays, primaryPtr->holeRadius,
+                                                             pupilRadius);
+            if (options.fields.empty()) {
+                Tracer3D::trace(*primaryPtr, *secondaryPtr, sensor, pupil, rayStartX, maxBounces,
+                                bundle, spot, 0.0f);
+                replicate.cameraHits = spot.getHits();
+                replicate.rmsSpotSize = spot.getRMSSpotSize();
+                if (rankByEE) replicate.ee80 = SpotAnalyzer::analyze(spot, sensor, scratch).ee80;
+            } else {
+                FieldEvaluation evaluation = evaluateFields3D(*primaryPtr, *secondaryPtr, sensor, pupil,
+                                                              rayStartX, maxBounces, options.fields);
+                replicate.cameraHits = evaluation.hits;
+                replicate.rmsSpotSize = evaluation.rmsSpotSize;
+            }
+        } else {
+            std::vector<float> heights = PupilSampler::sampleFan(shifted, numRays, rayYMin, rayYMax,
+                                                                 primaryPtr->holeRadius);
+            if (options.fields.empty()) {
+                sensor.clearHits();
+                bool aborted = false;
+                TelescopeOptimizer::traceFan(mirrors, &sensor, heights, std::vector<int>(), rayStartX,
+                                             maxBounces, nullptr, aborted, options.traceMode);
+                replicate.cameraHits = static_cast<int>(sensor.hitPoints.size());
+                replicate.rmsSpotSize = sensor.getRMSSpotSize();
+                if (rankByEE) replicate.ee80 = SpotAnalyzer::analyze(sensor, scratch).ee80;
+            } else {
+                FieldEvaluation evaluation = TelescopeOptimizer::evaluateFields(
+                    mirrors, &sensor, heights, rayStartX, options.fields, maxBounces, options.traceMode);
+                replicate.cameraHits = evaluation.hits;
+                replicate.rmsSpotSize = evaluation.rmsSpotSize;
+            }
+        }
+        result.raysTraced += static_cast<long long>(numRays) *
+                             std::max<size_t>(1, options.fields.anglesArcmin.size());
+        
+        replicate.hitPercentage = (100.0f * replicate.cameraHits) / numRays;
+        computeScore(replicate, numRays, rankByEE);
+        scoreSum += replicate.score;
+        scoreSumSq += static_cast<double>(replicate.score) * replicate.score;
+        rmsSum += replicate.rmsSpotSize;
+        rmsSumSq += static_cast<double>(replicate.rmsSpotSize) * replicate.rmsSpotSize;
+    }
+    
+    // Sample standard deviation over the replicates: the error of any one of them
+    auto deviation = [](double sum, double sumSq) {
+        double mean = sum / RQMC_REPLICATES;
+        double variance = (sumSq - RQMC_REPLICATES * mean * mean) / (RQMC_REPLICATES - 1);
+        return static_cast<float>(std::sqrt(std::max(0.0, variance)));
+    };
+    result.scoreError = deviation(scoreSum, scoreSumSq);
+    result.rmsError = deviation(rmsSum, rmsSumSq);
+}
+
+RefineOutcome BatchOptimizer::refineResult(
+    BatchResult& result,
+    DampedLeastSquaresResult& refined,
+    const CameraSensor& camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    const TraceOptions& options
+) {
+    refined = DampedLeastSquaresResult();
+    if (options.trace3D || !options.fields.empty()) return RefineOutcome::Skipped;
+    
+    std::vector<std::unique_ptr<Mirror>> mirrors;
+    buildSystem(result.config, mirrors);
+    const ParabolicMirror* primaryPtr = dynamic_cast<ParabolicMirror*>(mirrors[0].get());
+    HyperbolicMirror* secondaryPtr = dynamic_cast<HyperbolicMirror*>(mirrors[1].get());
+    secondaryPtr->centerX = result.bestSecondaryX;
+    secondaryPtr->centerY = result.bestSecondaryY;
+    
+    std::vector<float> heights = PupilSampler::sampleFan(options.sampler, numRays, rayYMin, rayYMax,
+                                                         primaryPtr->holeRadius);
+    refined = DampedLeastSquares::optimize(mirrors, &camera, heights, rayStartX, maxBounces);
+    BatchResult original = result;
+    
+    // Write the refined prescription back; mirrorSeparation is the secondary's
+    // axial position measured the way evaluateConfig places it
+    OpticalConfig& config = result.config;
+    float radiusSign = config.secondaryR < 0.0f ? -1.0f : 1.0f;
+    config.secondaryR = radiusSign * static_cast<float>(refined.params[SecondaryParams::Radius]);
+    config.secondaryF = config.secondaryR / 2.0f;
+    config.secondaryK = static_cast<float>(refined.params[SecondaryParams::Conic]);
+    config.mirrorSeparation = secondaryPtr->centerX - (primaryPtr->centerX - config.primaryF);
+    config.systemFocalLength = ParameterSweep::paraxialFocalLength(config);
+    result.bestSecondaryX = secondaryPtr->centerX;
+    result.bestSecondaryY = secondaryPtr->centerY;
+    
+    // Re-score with the ordinary tracer, exactly as evaluateConfig would
+    CameraSensor sensor = camera;
+    sensor.clearHits();
+    bool aborted = false;
+    result.raysTraced += TelescopeOptimizer::traceFan(mirrors, &sensor, heights, std::vector<int>(),
+                                                      rayStartX, maxBounces, nullptr, aborted,
+                                                      options.traceMode);
+    result.cameraHits = static_cast<int>(sensor.hitPoints.size());
+    result.hitPercentage = (100.0f * result.cameraHits) / numRays;
+    result.rmsSpotSize = sensor.getRMSSpotSize();
+    result.rmsError = CameraSensor::computeRMSStandardError(sensor.hitPoints);
+    SpotScratch scratch;
+    SpotMetrics metrics = SpotAnalyzer::analyze(sensor, scratch);
+    result.ee50 = metrics.ee50;
+    result.ee80 = metrics.ee80;
+    computeScore(result, numRays, options.objective == SpotObjective::EE80);
+    estimateSamplingError(result, mirrors, camera, numRays, rayStartX, rayYMin, rayYMax,
+                          maxBounces, options);
+    
+    // Lower RMS need not mean a better score (EE80 runs, or hits traded
+    // at the fan's edge): keep whichever ranks higher
+    if (result.score < original.score) {
+        long long raysTraced = result.raysTraced;
+        result = original;
+        result.raysTraced = raysTraced;
+        return RefineOutcome::Rejected;
+    }
+    return RefineOutcome::Improved;
+}
+
+FocusCurve BatchOptimizer::throughFocus(
+    const BatchResult& result,
+    const CameraSensor& camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    const TraceOptions& options,
+    float halfRange,
+    int steps
+) {
+    std::vector<std::unique_ptr<Mirror>> mirrors;
+    buildSystem(result.config, mirrors);
+    const ParabolicMirror* primaryPtr = dynamic_cast<ParabolicMirror*>(mirrors[0].get());
+    HyperbolicMirror* secondaryPtr = dynamic_cast<HyperbolicMirror*>(mirrors[1].get());
+    secondaryPtr->centerX = result.bestSecondaryX;
+    secondaryPtr->centerY = result.bestSecondaryY;
+    
+    // The same fan evaluateConfig ranked, traced whole
+    std::vector<float> heights = PupilSampler::sampleFan(options.sampler, numRays, rayYMin, rayYMax,
+                                                         primaryPtr->holeRadius);
+    FinalRayBundle bundle;
+    ThroughFocus::captureBundle(mirrors, heights, rayStartX, maxBounces, bundle);
+    return ThroughFocus::sweep(bundle, camera, -halfRange, halfRange, steps);
+}
+
+FieldEvaluation BatchOptimizer::evaluateFields3D(
+    const ParabolicMirror& primary,
+    const HyperbolicMirror& secondary,
+    const CameraSensor& camera,
+    const PupilSamples& pupil,
+    float rayStartX,
+    int maxBounces,
+    const FieldSet& fields
+) {
+    std::vector<float> angles = fields.anglesArcmin;
+    if (angles.empty()) angles.push_back(0.0f);
+    
+    FieldEvaluation evaluation;
+    evaluation.fields.resize(angles.size());
+    
+    // Each field is an independent vectorized bundle; trace them side by side
+    parallelFor(angles.size(), [&](size_t begin, size_t end) {
+        RayBundle3D bundle;
+        SpotDiagram spot;
+        for (size_t f = begin; f < end; f++) {
+            float theta = angles[f] * static_cast<float>(M_PI) / (180.0f * 60.0f);
+            Tracer3D::trace(primary, secondary, camera, pupil, rayStartX, maxBounces,
+                            bundle, spot, theta);
+            evaluation.fields[f].angleArcmin = angles[f];
+            evaluation.fields[f].hits = spot.getHits();
+            evaluation.fields[f].rmsSpotSize = spot.getRMSSpotSize();
+            evaluation.fields[f].rmsError = spot.getRMSStandardError();
+        }
+    }, 1);
+    
+    TelescopeOptimizer::combineFields(fields, evaluation);
+    return evaluation;
+}
+
 std::vector<BatchResult> BatchOptimizer::optimizeBatch(
     const std::string& csvFilename,
     CameraSensor* camera,
@@ -295,66 +792,547 @@ std::vector<BatchResult> BatchOptimizer::optimizeBatch(
     float rayYMin,
     float rayYMax,
     int maxBounces,
-    int topN
+    int topN,
+    const TraceOptions& options,
+    const std::string& cacheFilename,
+    const ProgressSettings& progressSettings,
+    const ShardSpec& shard
 ) {
     std::vector<OpticalConfig> configs = loadConfigsFromCSV(csvFilename);
-    std::vector<BatchResult> results;
+    ConfigSource source = [&configs](size_t begin, size_t end, std::vector<OpticalConfig>& block) {
+        block.assign(configs.begin() + begin, configs.begin() + end);
+    };
+    return runBatch(configs.size(), source, camera, numRays, rayStartX, rayYMin, rayYMax,
+                    maxBounces, topN, options, cacheFilename, progressSettings, shard);
+}
+
+std::vector<BatchResult> BatchOptimizer::optimizeSweep(
+    const ParameterSweep& sweep,
+    CameraSensor* camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    int topN,
+    const TraceOptions& options,
+    const std::string& cacheFilename,
+    const ProgressSettings& progressSettings,
+    const ShardSpec& shard
+) {
+    ConfigSource source = [&sweep](size_t begin, size_t end, std::vector<OpticalConfig>& block) {
+        block.resize(end - begin);
+        for (size_t i = begin; i < end; i++) block[i - begin] = sweep.at(i);
+    };
+    return runBatch(sweep.size(), source, camera, numRays, rayStartX, rayYMin, rayYMax,
+                    maxBounces, topN, options, cacheFilename, progressSettings, shard);
+}
+
+std::vector<BatchResult> BatchOptimizer::runBatch(
+    size_t totalRows,
+    const ConfigSource& source,
+    CameraSensor* camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    int topN,
+    const TraceOptions& options,
+    const std::string& cacheFilename,
+    const ProgressSettings& progressSettings,
+    const ShardSpec& shard
+) {
+    std::vector<BatchResult> best;
+    long long raysTraced = 0;
+    int cachedCount = 0;
+    PrefilterStats prefilterStats;
     
-    int totalConfigs = configs.size();
-    int processedCount = 0;
+    // Always deduplicates within the batch; persists across runs when a file is given
+    ResultCache cache(cacheFilename);
+    if (!cacheFilename.empty()) {
+        int loaded = cache.load();
+        std::cout << "Result cache " << cacheFilename << ": " << loaded << " entries" << std::endl;
+    }
+    
+    // Rows of this shard: a contiguous range, or every row whose hash matches
+    size_t firstRow = 0, lastRow = totalRows;
+    long long totalConfigs = totalRows;
+    if (shard.count > 1) {
+        if (shard.byHash) {
+            totalConfigs = 0;
+            for (size_t row = 0; row < totalRows; row++) {
+                totalConfigs += shard.contains(static_cast<int>(row), static_cast<int>(totalRows));
+            }
+        } else {
+            firstRow = totalRows * shard.index / shard.count;
+            lastRow = totalRows * (shard.index + 1) / shard.count;
+            totalConfigs = lastRow - firstRow;
+        }
+        std::cout << "Shard " << shard.index << "/" << shard.count
+                  << (shard.byHash ? " (hash)" : " (range)") << ": "
+                  << totalConfigs << " of " << totalRows << " rows" << std::endl;
+    }
     
     std::cout << "Evaluating " << totalConfigs << " configurations..." << std::endl;
     
-    for (const auto& config : configs) {
-        BatchResult result = evaluateConfig(
-            config, camera, numRays,
-            rayStartX, rayYMin, rayYMax, maxBounces
-        );
-        results.push_back(result);
+    ProgressReporter progress(static_cast<int>(totalConfigs), static_cast<int>(workerThreadCount()),
+                              progressSettings);
+    // The running top N replaces the output file on every report, so the
+    // GUI can follow the run; shard files keep full precision as at the end
+    LiveResults live(progressSettings.resultsFile, topN, shard.count > 1);
+    progress.onReport([&live] { live.write(); });
+    progress.start();
+    
+    // The shard's rows of [begin, end) that pass the pre-filter
+    ConfigSource fetch = [&](size_t begin, size_t end, std::vector<OpticalConfig>& block) {
+        source(begin, end, block);
+        if (shard.count > 1 && shard.byHash) {
+            block.erase(std::remove_if(block.begin(), block.end(),
+                                       [&shard, totalRows](const OpticalConfig& config) {
+                                           return !shard.contains(config.rowIndex,
+                                                                  static_cast<int>(totalRows));
+                                       }),
+                        block.end());
+        }
+        
+        // Rows that cannot work are dropped before any tracing
+        size_t removed = ConfigPrefilter::apply(block, options.prefilter, prefilterStats);
+        for (size_t r = 0; r < removed; r++) {
+            progress.configDone(0, -std::numeric_limits<float>::infinity());
+        }
+    };
+    
+    ScreeningReport screening;
+    if (options.screening.enabled) {
+        screening = screenRows(firstRow, lastRow, source, fetch, camera, numRays, rayStartX,
+                               rayYMin, rayYMax, maxBounces, topN, options, cache, progress,
+                               live, best, raysTraced, cachedCount);
+    } else {
+        // Rows are fetched and evaluated a block at a time, so a generated sweep
+        // never exists in memory as a whole; only the running top N is kept
+        const size_t BLOCK_ROWS = 1 << 16;
+        std::vector<OpticalConfig> block;
+        std::vector<BatchResult> results;
         
-        processedCount++;
-        if (processedCount % 100 == 0 || processedCount == totalConfigs) {
-            std::cout << "Progress: " << processedCount << "/" << totalConfigs 
-                     << " (" << (100 * processedCount / totalConfigs) << "%)" << std::endl;
+        for (size_t begin = firstRow; begin < lastRow; begin += BLOCK_ROWS) {
+            size_t end = std::min(lastRow, begin + BLOCK_ROWS);
+            fetch(begin, end, block);
+            
+            evaluateBlock(block, camera, numRays, rayStartX, rayYMin, rayYMax, maxBounces,
+                          options, cache, progress, live, results, cachedCount);
+            for (const auto& result : results) raysTraced += result.raysTraced;
+            
+            best.insert(best.end(), results.begin(), results.end());
+            std::sort(best.begin(), best.end(), ranksAbove);
+            if (best.size() > static_cast<size_t>(topN)) {
+                best.resize(topN);
+            }
         }
     }
+    progress.stop();
+    live.write();
     
-    // Sort by score (descending)
-    std::sort(results.begin(), results.end(),
-              [](const BatchResult& a, const BatchResult& b) {
-                  return a.score > b.score;
-              });
+    if (options.prefilter != PrefilterMode::Off) {
+        std::cout << prefilterStats.summary(options.prefilter) << std::endl;
+    }
+    long long screenedOut = screening.rows - screening.traced;
+    if (options.screening.enabled) {
+        std::cout << "Surrogate screening: traced " << screening.traced << " of " << screening.rows
+                  << " rows in " << screening.rounds << " rounds, avoided " << screenedOut
+                  << " (" << std::fixed << std::setprecision(1)
+                  << (screening.rows > 0 ? 100.0 * screenedOut / screening.rows : 0.0)
+                  << "%); score leave-one-out error " << std::setprecision(2) << screening.looError
+                  << std::defaultfloat << std::endl;
+    }
+    if (totalConfigs > 0) {
+        std::cout << "Rays traced: " << raysTraced << " (" << raysTraced / totalConfigs
+                  << " per config" << (options.earlyTermination ? ", early termination on" : "")
+                  << ")" << std::endl;
+        std::cout << "Reused " << cachedCount << " cached/duplicate results, evaluated "
+                  << (totalConfigs - prefilterStats.rejected - screenedOut - cachedCount) << std::endl;
+    }
+    
+    std::cout << "\nTop " << best.size() << " configurations found!" << std::endl;
+    return best;
+}
+
+ScreeningReport BatchOptimizer::screenRows(
+    size_t firstRow,
+    size_t lastRow,
+    const ConfigSource& source,
+    const ConfigSource& fetch,
+    CameraSensor* camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    int topN,
+    const TraceOptions& options,
+    ResultCache& cache,
+    ProgressReporter& progress,
+    LiveResults& live,
+    std::vector<BatchResult>& best,
+    long long& raysTraced,
+    int& cachedCount
+) {
+    typedef RBFSurrogate::Point Point;
+    const ScreeningSettings& settings = options.screening;
+    ScreeningReport report;
     
-    // Return top N
-    if (results.size() > static_cast<size_t>(topN)) {
-        results.resize(topN);
+    // Every row that could be traced, and its design parameters. Only the
+    // parameters are kept; rows are fetched again when they are traced.
+    const size_t BLOCK_ROWS = 1 << 16;
+    std::vector<int> rows;
+    std::vector<Point> points;
+    std::vector<OpticalConfig> block;
+    for (size_t begin = firstRow; begin < lastRow; begin += BLOCK_ROWS) {
+        fetch(begin, std::min(lastRow, begin + BLOCK_ROWS), block);
+        for (const auto& config : block) {
+            Point point;
+            for (int f = 0; f < DESIGN_PARAMETERS; f++) point[f] = designParameter(config, f);
+            rows.push_back(config.rowIndex);
+            points.push_back(point);
+        }
     }
+    size_t n = rows.size();
+    report.rows = n;
+    if (n == 0) return report;
     
-    std::cout << "\nTop " << results.size() << " configurations found!" << std::endl;
-    return results;
+    // Scale every parameter to [0, 1]; fixed parameters collapse to 0
+    for (int f = 0; f < DESIGN_PARAMETERS; f++) {
+        float lo = points[0][f], hi = points[0][f];
+        for (const auto& point : points) {
+            lo = std::min(lo, point[f]);
+            hi = std::max(hi, point[f]);
+        }
+        float scale = hi > lo ? 1.0f / (hi - lo) : 0.0f;
+        for (auto& point : points) point[f] = (point[f] - lo) * scale;
+    }
+    
+    std::vector<char> traced(n, 0);
+    std::vector<BatchResult> evaluated;  // Every traced row, in tracing order
+    std::vector<size_t> evaluatedRow;    // Its index into rows
+    std::vector<BatchResult> results;
+    std::vector<OpticalConfig> single;
+    auto traceRows = [&](const std::vector<size_t>& picks, const std::vector<WarmStart>* hints) {
+        block.clear();
+        for (size_t p : picks) {
+            source(rows[p], rows[p] + 1, single);
+            block.push_back(single[0]);
+            traced[p] = 1;
+        }
+        evaluateBlock(block, camera, numRays, rayStartX, rayYMin, rayYMax, maxBounces,
+                      options, cache, progress, live, results, cachedCount, hints);
+        for (size_t i = 0; i < picks.size(); i++) {
+            raysTraced += results[i].raysTraced;
+            evaluated.push_back(results[i]);
+            evaluatedRow.push_back(picks[i]);
+        }
+    };
+    
+    // Initial sample: farthest-point selection from a seeded random pool,
+    // so the first fit sees the whole parameter space evenly
+    size_t initial = std::min(n, static_cast<size_t>(std::max(settings.initialSamples, topN)));
+    std::vector<size_t> pool(n);
+    for (size_t i = 0; i < n; i++) pool[i] = i;
+    size_t poolSize = std::min(n, 16 * initial);
+    std::mt19937_64 rng(options.sampler.seed);
+    for (size_t i = 0; i < poolSize && poolSize < n; i++) {
+        std::uniform_int_distribution<size_t> pick(i, n - 1);
+        std::swap(pool[i], pool[pick(rng)]);
+    }
+    pool.resize(poolSize);
+    
+    std::vector<size_t> picks;
+    std::vector<double> nearest(poolSize, std::numeric_limits<double>::max());
+    size_t next = 0;
+    for (size_t k = 0; k < initial; k++) {
+        picks.push_back(pool[next]);
+        const Point& chosen = points[pool[next]];
+        nearest[next] = -1.0;
+        size_t farthest = 0;
+        for (size_t i = 0; i < poolSize; i++) {
+            if (nearest[i] < 0.0) continue;
+            double distSq = 0.0;
+            for (int f = 0; f < DESIGN_PARAMETERS; f++) {
+                double diff = points[pool[i]][f] - chosen[f];
+                distSq += diff * diff;
+            }
+            nearest[i] = std::min(nearest[i], distSq);
+            if (nearest[i] > nearest[farthest]) farthest = i;
+        }
+        next = farthest;
+    }
+    traceRows(picks, nullptr);
+    
+    // Spacing of the initial sample: the farthest any pool row is from it
+    double coverRadiusSq = 0.0;
+    for (double distSq : nearest) coverRadiusSq = std::max(coverRadiusSq, distSq);
+    
+    // Refine: fit, then trace the untraced rows whose optimistic score could
+    // still reach the current top N, best first, until none are left
+    RBFSurrogate surrogate;
+    std::vector<double> upper(n);
+    while (evaluated.size() < n) {
+        std::vector<float> scores;
+        for (const auto& result : evaluated) scores.push_back(result.score);
+        float threshold = -std::numeric_limits<float>::infinity();
+        if (scores.size() >= static_cast<size_t>(topN) && topN > 0) {
+            std::nth_element(scores.begin(), scores.begin() + (topN - 1), scores.end(),
+                             std::greater<float>());
+            threshold = scores[topN - 1];
+        }
+        
+        // Centres: the initial sample, then the best scorers, one per point
+        std::vector<size_t> order(evaluated.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::stable_sort(order.begin() + initial, order.end(), [&evaluated](size_t a, size_t b) {
+            return ranksAbove(evaluated[a], evaluated[b]);
+        });
+        std::vector<Point> centres;
+        std::vector<std::vector<double>> outputs(2);
+        std::set<Point> seen;
+        for (size_t e : order) {
+            if (centres.size() >= MAX_SURROGATE_CENTRES) break;
+            const Point& point = points[evaluatedRow[e]];
+            if (!seen.insert(point).second) continue;
+            centres.push_back(point);
+            outputs[0].push_back(evaluated[e].score);
+            outputs[1].push_back(evaluated[e].bestSecondaryX - nominalSecondaryX(evaluated[e].config));
+        }
+        
+        std::vector<size_t> candidates;
+        if (!surrogate.fit(centres, outputs)) {
+            // Nothing to predict with: trace everything left
+            for (size_t i = 0; i < n; i++) {
+                if (!traced[i]) candidates.push_back(i);
+            }
+        } else {
+            report.looError = surrogate.looError(0);
+            double margin = settings.confidence * report.looError;
+            parallelFor(n, [&](size_t begin, size_t end) {
+                double prediction[2];
+                for (size_t i = begin; i < end; i++) {
+                    if (traced[i]) {
+                        upper[i] = -std::numeric_limits<double>::infinity();
+                        continue;
+                    }
+                    surrogate.predict(points[i], prediction);
+                    upper[i] = prediction[0] + margin;
+                }
+            }, 1024);
+            
+            // Rows near a traced row that already reaches the top N are traced
+            // whatever the prediction: the score surface has cliffs and
+            // plateaus of tied rows that a smooth fit misses
+            std::vector<size_t> leaders;
+            for (size_t e = 0; e < evaluated.size(); e++) {
+                if (evaluated[e].score >= threshold) leaders.push_back(evaluatedRow[e]);
+            }
+            parallelFor(n, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    if (traced[i] || upper[i] >= threshold) continue;
+                    for (size_t leader : leaders) {
+                        double distSq = 0.0;
+                        for (int f = 0; f < DESIGN_PARAMETERS; f++) {
+                            double diff = points[i][f] - points[leader][f];
+                            distSq += diff * diff;
+                        }
+                        if (distSq <= coverRadiusSq) {
+                            upper[i] = threshold;
+                            break;
+                        }
+                    }
+                }
+            }, 1024);
+            for (size_t i = 0; i < n; i++) {
+                if (!traced[i] && upper[i] >= threshold) candidates.push_back(i);
+            }
+        }
+        if (candidates.empty()) break;
+        
+        // Most promising first; the batch grows with the candidate count
+        size_t batch = std::min(candidates.size(),
+                                std::max(static_cast<size_t>(std::max(settings.batchSize, 1)),
+                                         candidates.size() / 4));
+        std::partial_sort(candidates.begin(), candidates.begin() + batch, candidates.end(),
+                          [&upper](size_t a, size_t b) {
+                              return upper[a] != upper[b] ? upper[a] > upper[b] : a < b;
+                          });
+        candidates.resize(batch);
+        
+        // The position surrogate seeds warm starts; scattered rows have no
+        // traced neighbour to chain from
+        std::vector<WarmStart> hints;
+        if (options.warmStart && surrogate.size() > 0) {
+            double prediction[2];
+            for (size_t c : candidates) {
+                surrogate.predict(points[c], prediction);
+                WarmStart hint;
+                hint.valid = true;
+                hint.offset = static_cast<float>(prediction[1]);
+                hints.push_back(hint);
+            }
+        }
+        traceRows(candidates, hints.empty() ? nullptr : &hints);
+        report.rounds++;
+    }
+    
+    report.traced = evaluated.size();
+    for (size_t i = 0; i < n; i++) {
+        if (!traced[i]) progress.configDone(0, -std::numeric_limits<float>::infinity());
+    }
+    
+    std::sort(evaluated.begin(), evaluated.end(), ranksAbove);
+    if (evaluated.size() > static_cast<size_t>(topN)) evaluated.resize(topN);
+    best = evaluated;
+    return report;
+}
+
+void BatchOptimizer::evaluateBlock(
+    const std::vector<OpticalConfig>& configs,
+    CameraSensor* camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    const TraceOptions& options,
+    ResultCache& cache,
+    ProgressReporter& progress,
+    LiveResults& live,
+    std::vector<BatchResult>& results,
+    int& cachedCount,
+    const std::vector<WarmStart>* hints
+) {
+    int totalConfigs = configs.size();
+    
+    // Cached rows and repeats of an earlier row need no tracing; the rest
+    // are evaluated in parallel, each worker on its own copy of the camera
+    enum RowSource : unsigned char { Cached, Repeat, Evaluated };
+    std::vector<std::uint64_t> keys(totalConfigs);
+    std::vector<RowSource> sources(totalConfigs, Evaluated);
+    std::vector<int> pending;
+    std::unordered_map<std::uint64_t, int> firstRows;  // Key -> first pending row with it
+    results.assign(totalConfigs, BatchResult());
+    
+    for (int i = 0; i < totalConfigs; i++) {
+        keys[i] = ResultCache::makeKey(configs[i], camera, numRays, rayStartX,
+                                       rayYMin, rayYMax, maxBounces, options);
+        results[i].config = configs[i];
+        if (cache.lookup(keys[i], results[i])) {
+            sources[i] = Cached;
+            live.offer(results[i]);
+            progress.configDone(0, results[i].score);
+        } else if (!firstRows.emplace(keys[i], i).second) {
+            sources[i] = Repeat;  // Filled from the first row with this key
+            progress.configDone(0, -std::numeric_limits<float>::infinity());
+        } else {
+            pending.push_back(i);
+        }
+    }
+    cachedCount += totalConfigs - static_cast<int>(pending.size());
+    
+    // Warm starts walk the pending rows in locality order, in fixed-length
+    // chains: each row starts from the previous row's optimum. Chains do not
+    // depend on the thread count, so neither do the results.
+    size_t chainRows = 1;
+    if (options.warmStart && !hints) {
+        localityOrder(configs, pending);
+        chainRows = WARM_CHAIN_ROWS;
+    }
+    size_t numChains = (pending.size() + chainRows - 1) / chainRows;
+    
+    int numWorkers = static_cast<int>(std::min<size_t>(workerThreadCount(),
+                                                       std::max<size_t>(numChains, 1)));
+    std::atomic<size_t> next{0};
+    auto worker = [&](int thread) {
+        inParallelWorker() = numWorkers > 1;
+        CameraSensor sensor = *camera;
+        for (size_t c = next.fetch_add(1); c < numChains; c = next.fetch_add(1)) {
+            WarmStart warm;
+            size_t chainEnd = std::min(pending.size(), (c + 1) * chainRows);
+            for (size_t p = c * chainRows; p < chainEnd; p++) {
+                auto begin = std::chrono::steady_clock::now();
+                int i = pending[p];
+                const WarmStart* start = nullptr;
+                if (options.warmStart) start = hints ? &(*hints)[i] : &warm;
+                results[i] = evaluateConfig(configs[i], &sensor, numRays, rayStartX, rayYMin,
+                                            rayYMax, maxBounces, options, start);
+                // Adaptive ray count: a NaN error (deterministic sampler) never exceeds the target
+                for (int doublings = 0; doublings < MAX_RAY_DOUBLINGS &&
+                                        results[i].scoreError > options.targetScoreError &&
+                                        options.targetScoreError > 0.0f; doublings++) {
+                    long long spent = results[i].raysTraced;
+                    results[i] = evaluateConfig(configs[i], &sensor, numRays << (doublings + 1),
+                                                rayStartX, rayYMin, rayYMax, maxBounces, options, start);
+                    results[i].raysTraced += spent;
+                }
+                warm.valid = results[i].cameraHits > 0;
+                warm.offset = results[i].bestSecondaryX - nominalSecondaryX(configs[i]);
+                progress.addBusyTime(thread, std::chrono::steady_clock::now() - begin);
+                live.offer(results[i]);
+                progress.configDone(results[i].raysTraced, results[i].score);
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < numWorkers; t++) workers.emplace_back(worker, t);
+    worker(0);
+    inParallelWorker() = false;
+    for (auto& thread : workers) thread.join();
+    
+    // A warm start depends on more than its key: a chain on which rows
+    // preceded it in this block (after cache hits, sharding and the
+    // pre-filter), a screening hint on the surrogate fitted so far. Neither
+    // is stored under the cold key it was looked up by; repeats still
+    // share it.
+    bool warmStarted = options.warmStart;
+    for (int i = 0; i < totalConfigs; i++) {
+        if (sources[i] == Repeat) {
+            OpticalConfig config = results[i].config;
+            results[i] = results[firstRows[keys[i]]];
+            results[i].config = config;
+            results[i].raysTraced = 0;
+            live.offer(results[i]);
+        } else if (sources[i] == Evaluated && !warmStarted) {
+            cache.store(keys[i], results[i]);
+        }
+    }
 }
 
-void BatchOptimizer::saveResultsToCSV(
+bool BatchOptimizer::saveResultsToCSV(
     const std::vector<BatchResult>& results,
-    const std::string& outputFilename
+    const std::string& outputFilename,
+    bool exact
 ) {
-    std::ofstream file(outputFilename);
+    std::string temp = outputFilename + ".tmp";
+    std::ofstream file(temp);
     
     if (!file.is_open()) {
-        std::cerr << "Error: Could not create output file " << outputFilename << std::endl;
-        return;
+        std::cerr << "Error: Could not create output file " << temp << std::endl;
+        return false;
     }
     
     // Write header
     file << "Rank,Score,CameraHits,HitPercentage,RMSSpotSize,BestSecondaryX,BestSecondaryY,"
          << "PrimaryDiameter,SecondaryDiameter,PrimaryR,SecondaryR,PrimaryF,SecondaryF,"
-         << "PrimaryK,SecondaryK,MirrorSeparation,SystemFocalLength,OriginalRowIndex\n";
+         << "PrimaryK,SecondaryK,MirrorSeparation,SystemFocalLength,OriginalRowIndex,"
+         << "ScoreError,RMSError,EE50um,EE80um\n";
     
     // Write results
     int rank = 1;
+    const int digits = 9;  // Round-trips any float
     for (const auto& result : results) {
-        file << rank++ << ","
-             << std::fixed << std::setprecision(2) << result.score << ","
+        file << rank++ << ",";
+        if (exact) {
+            file << std::defaultfloat << std::setprecision(digits);
+        } else {
+            file << std::fixed << std::setprecision(2);
+        }
+        file << result.score << ","
              << result.cameraHits << ","
              << result.hitPercentage << ","
              << result.rmsSpotSize << ","
@@ -370,9 +1348,149 @@ void BatchOptimizer::saveResultsToCSV(
              << result.config.secondaryK << ","
              << result.config.mirrorSeparation << ","
              << result.config.systemFocalLength << ","
-             << result.config.rowIndex << "\n";
+             << result.config.rowIndex << ","
+             << std::setprecision(exact ? digits : 4);
+        // Not computed (deterministic samplers, field runs): leave the cells empty
+        auto optional = [&file](float value, const char* separator) {
+            if (!std::isnan(value)) file << value;
+            file << separator;
+        };
+        optional(result.scoreError, ",");
+        optional(result.rmsError, ",");
+        file << std::setprecision(exact ? digits : 2);
+        optional(result.ee50 * 1000.0f, ",");
+        optional(result.ee80 * 1000.0f, "\n");
     }
     
     file.close();
-    std::cout << "Results saved to " << outputFilename << std::endl;
-}
\ No newline at end of file
+    if (!file || std::rename(temp.c_str(), outputFilename.c_str()) != 0) {
+        std::cerr << "Error: Could not write output file " << outputFilename << std::endl;
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::vector<BatchResult> BatchOptimizer::loadBatchResultsFromCSV(const std::string& filename) {
+    std::vector<BatchResult> results;
+    std::ifstream file(filename);
+    
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return results;
+    }
+    
+    std::string line;
+    std::getline(file, line);  // Skip header
+    while (std::getline(file, line)) {
+        OpticalConfig config;
+        if (!parseResultRow(line, config)) continue;
+        
+        BatchResult result;
+        result.config = config;
+        result.cameraHits = config.cameraHits;
+        result.hitPercentage = config.hitPercentage;
+        result.rmsSpotSize = config.rmsSpotSize;
+        result.bestSecondaryX = config.bestSecondaryX;
+        result.bestSecondaryY = config.bestSecondaryY;
+        result.score = config.score;
+        result.rmsError = 0.0f;
+        result.scoreError = 0.0f;
+        result.raysTraced = 0;
+        result.ee50 = 0.0f;
+        result.ee80 = 0.0f;
+        
+        std::vector<std::string> tokens = splitString(line, ',');
+        if (!line.empty() && line.back() == ',') tokens.push_back("");  // Empty EE80 cell
+        if (tokens.size() >= 22) {
+            auto optional = [](const std::string& token) {
+                return token.empty() ? std::numeric_limits<float>::quiet_NaN() : stringToFloat(token);
+            };
+            result.scoreError = optional(tokens[18]);
+            result.rmsError = optional(tokens[19]);
+            result.ee50 = optional(tokens[20]) / 1000.0f;
+            result.ee80 = optional(tokens[21]) / 1000.0f;
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool BatchOptimizer::ranksAbove(const BatchResult& a, const BatchResult& b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.config.rowIndex < b.config.rowIndex;
+}
+
+std::vector<BatchResult> BatchOptimizer::mergeResults(const std::vector<std::string>& filenames,
+                                                      int topN) {
+    std::vector<BatchResult> all;
+    for (const auto& filename : filenames) {
+        std::vector<BatchResult> part = loadBatchResultsFromCSV(filename);
+        std::cout << "Loaded " << part.size() << " results from " << filename << std::endl;
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    
+    // A row listed by more than one file (overlapping shards) counts once
+    std::sort(all.begin(), all.end(), ranksAbove);
+    std::unordered_set<int> seen;
+    std::vector<BatchResult> merged;
+    for (const auto& result : all) {
+        if (static_cast<int>(merged.size()) >= topN) break;
+        if (seen.insert(result.config.rowIndex).second) merged.push_back(result);
+    }
+    return merged;
+}
+
+bool ShardSpec::parse(const std::string& text, ShardSpec& shard) {
+    size_t slash = text.find('/');
+    if (slash == std::string::npos) return false;
+    try {
+        shard.index = std::stoi(text.substr(0, slash));
+        shard.count = std::stoi(text.substr(slash + 1));
+    } catch (...) {
+        return false;
+    }
+    return shard.count >= 1 && shard.index >= 0 && shard.index < shard.count;
+}
+
+bool ShardSpec::contains(int rowIndex, int totalRows) const {
+    if (count <= 1) return true;
+    if (byHash) {
+        // splitmix64 finaliser: neighbouring rows (similar designs, similar
+        // cost) spread evenly over the shards
+        std::uint64_t z = static_cast<std::uint64_t>(rowIndex) + 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        return static_cast<int>(z % static_cast<std::uint64_t>(count)) == index;
+    }
+    long long begin = static_cast<long long>(totalRows) * index / count;
+    long long end = static_cast<long long>(totalRows) * (index + 1) / count;
+    return rowIndex >= begin && rowIndex < end;
+}
+
+LiveResults::LiveResults(const std::string& filename, int topN, bool exact)
+    : filename(filename), topN(topN), exact(exact) {}
+
+void LiveResults::offer(const BatchResult& result) {
+    if (filename.empty() || topN <= 0) return;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (best.size() >= static_cast<size_t>(topN) && !BatchOptimizer::ranksAbove(result, best.back())) {
+        return;
+    }
+    best.insert(std::upper_bound(best.begin(), best.end(), result, BatchOptimizer::ranksAbove), result);
+    if (best.size() > static_cast<size_t>(topN)) best.pop_back();
+    changed = true;
+}
+
+void LiveResults::write() {
+    std::vector<BatchResult> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!changed) return;
+        snapshot = best;
+        changed = false;
+    }
+    BatchOptimizer::saveResultsToCSV(snapshot, filename, exact);
+}
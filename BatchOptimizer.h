@@ -4,9 +4,16 @@
 #include "Ray.h"
 #include "Mirror.h"
 #include "Camera.h"
+#include "Optimizer.h"
+#include "Tracer3D.h"
+#include "PupilSampler.h"
+#include "ThroughFocus.h"
+#include "DampedLeastSquares.h"
+#include "Progress.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <cmath>
 
 struct OpticalConfig {
@@ -39,17 +46,120 @@ struct BatchResult {
     float bestSecondaryX;
     float bestSecondaryY;
     float score;  // Combined metric for ranking
+    float rmsError;    // Standard error of rmsSpotSize from pupil sampling; NaN for
+                       // the deterministic samplers, which have none
+    float scoreError;  // Standard error of score (hit fraction and RMS terms); NaN likewise
+    long long raysTraced;  // Rays actually traced (less than the full scan with early exit)
+    float ee50;  // Encircled-energy radii at the best position (mm, pixel resolution)
+    float ee80;
 };
 
+// What the secondary scan minimises (after maximising hits)
+enum class SpotObjective {
+    RMS,   // RMS spot radius
+    EE80   // 80% encircled-energy radius on the sensor's pixel grid
+};
+
+// What BatchOptimizer::refineResult did to a result
+enum class RefineOutcome {
+    Skipped,   // 3-D or field run: the refinement only models the on-axis 2-D fan
+    Improved,  // Refined prescription kept
+    Rejected   // Refinement lowered the ranking score; result left as it was
+};
+
+// Which rows ConfigPrefilter drops before a batch traces them
+enum class PrefilterMode {
+    Off,       // Trace every row
+    Standard,  // Drop invalid rows and rows that can only score zero
+    Strict     // Also drop rows failing the first-order focus checks
+};
+
+// Surrogate screening of large sweeps: trace a space-filling subset, fit
+// RBF surrogates of score and best secondary position over the design
+// parameters, and keep tracing the untraced rows whose predicted score plus
+// a margin of `confidence` leave-one-out errors could still reach the top N.
+// Approximate: the margin is a heuristic, not a bound, so a row the
+// surrogate underestimates by more can be missed (tests/check_screening
+// compares against the full trace on a fixed sweep).
+struct ScreeningSettings {
+    bool enabled = false;
+    int initialSamples = 256;  // Space-filling rows traced before the first fit
+    int batchSize = 64;        // Least rows traced per refinement round
+    float confidence = 2.0f;   // Margin above the predicted score, in leave-one-out errors
+};
+
+// What a screened batch traced
+struct ScreeningReport {
+    long long rows = 0;    // Rows of the shard that passed the pre-filter
+    long long traced = 0;  // Rows evaluated, including cache hits
+    int rounds = 0;        // Refinement rounds after the initial sample
+    double looError = 0.0; // Leave-one-out RMS error of the final score surrogate
+};
+
+// Optional tracing modes for batch evaluation
+struct TraceOptions {
+    bool trace3D = false;  // Trace surfaces of revolution over the annular pupil (Tracer3D)
+    FieldSet fields;       // Off-axis field angles; empty = on-axis only
+    SamplerSettings sampler;  // Pupil sampling strategy and seed
+    bool earlyTermination = true;  // Abandon scan positions that can no longer win
+    bool exploitSymmetry = true;   // Trace half the fan when the system is symmetric about the axis
+    SpotObjective objective = SpotObjective::RMS;  // Field scans always rank by RMS
+    TraceMode traceMode = TraceMode::Sequential;   // 2-D fans; results are the same either way
+    PrefilterMode prefilter = PrefilterMode::Standard;  // Screen rows before tracing (ConfigPrefilter)
+    bool warmStart = false;  // Walk rows in locality order, each scan local to its neighbour's optimum
+    ScreeningSettings screening;  // Trace only the rows a surrogate says could reach the top N
+    float targetScoreError = 0.0f;  // Double a row's rays until its scoreError is at most this
+                                    // (0 = off; random samplers only, up to 2^MAX_RAY_DOUBLINGS x)
+};
+
+// Where an already-solved neighbouring configuration found its best
+// secondary position, so evaluateConfig only searches locally
+struct WarmStart {
+    bool valid = false;
+    float offset = 0.0f;  // Best secondary X relative to the neighbour's nominal position
+};
+
+// One slice of the input grid, so independent processes can each score
+// part of a sweep and write a partial top-N file for BatchOptimizer::mergeResults
+struct ShardSpec {
+    int index = 0;         // 0-based shard number
+    int count = 1;         // Number of shards; 1 = the whole grid
+    bool byHash = false;   // Rows by a hash of rowIndex instead of contiguous ranges
+
+    // Parse "i/N" with 0 <= i < N
+    static bool parse(const std::string& text, ShardSpec& shard);
+    bool contains(int rowIndex, int totalRows) const;
+};
+
+class ParameterSweep;
+class ResultCache;
+class LiveResults;
+
 class BatchOptimizer {
 public:
+    // Geometry shared by buildSystem, evaluateConfig and ConfigPrefilter
+    static constexpr float PRIMARY_CENTER_X = 500.0f;  // Fixed primary vertex
+    static constexpr float HOLE_MARGIN = 5.0f;         // Primary hole radius beyond the secondary's
+    static constexpr float SCAN_HALF_RANGE = 50.0f;    // Secondary scan about its nominal position
+    static constexpr int MAX_RAY_DOUBLINGS = 4;        // --target-error: most times a row's rays double
+    
     // Load optical configurations from CSV file
     static std::vector<OpticalConfig> loadConfigsFromCSV(const std::string& filename);
     
     // Load optimization results CSV (includes best positions)
     static std::vector<OpticalConfig> loadResultsFromCSV(const std::string& filename);
     
-    // Evaluate a single optical configuration
+    // Parse one data row of a results CSV; false for short or header rows
+    static bool parseResultRow(const std::string& line, OpticalConfig& config);
+    
+    // Primary at its fixed position and the secondary at the nominal
+    // spacing in front of the primary focus, as evaluateConfig scans them
+    static void buildSystem(const OpticalConfig& config,
+                            std::vector<std::unique_ptr<Mirror>>& mirrors);
+    
+    // Evaluate a single optical configuration. With a valid warmStart the
+    // scan starts at the neighbour's optimum and only widens while the best
+    // position sits at the edge of the searched window.
     static BatchResult evaluateConfig(
         const OpticalConfig& config,
         CameraSensor* camera,
@@ -57,10 +167,22 @@ public:
         float rayStartX,
         float rayYMin,
         float rayYMax,
-        int maxBounces = 4
+        int maxBounces = 4,
+        const TraceOptions& options = TraceOptions(),
+        const WarmStart* warmStart = nullptr
     );
     
-    // Batch process all configurations and return sorted results
+    // Secondary X that buildSystem places the secondary at
+    static float nominalSecondaryX(const OpticalConfig& config);
+    
+    // Reorder rows (indices into configs) along a reflected mixed-radix
+    // (Gray-code) traversal of the distinct parameter values, so that on a
+    // grid consecutive rows differ in one parameter by one step
+    static void localityOrder(const std::vector<OpticalConfig>& configs, std::vector<int>& rows);
+    
+    // Batch process all configurations and return sorted results.
+    // Uncached configurations are evaluated on all cores; progress is
+    // reported from its own thread every progress.intervalSeconds.
     static std::vector<BatchResult> optimizeBatch(
         const std::string& csvFilename,
         CameraSensor* camera,
@@ -69,18 +191,217 @@ public:
         float rayYMin,
         float rayYMax,
         int maxBounces = 4,
-        int topN = 10  // Return top N results
+        int topN = 10,  // Return top N results
+        const TraceOptions& options = TraceOptions(),
+        const std::string& cacheFilename = "",  // Persistent result cache (ResultCache)
+        const ProgressSettings& progress = ProgressSettings(),
+        const ShardSpec& shard = ShardSpec()
+    );
+    
+    // As optimizeBatch, over a generated parameter sweep instead of a CSV.
+    // Configurations are enumerated lazily, a block at a time.
+    static std::vector<BatchResult> optimizeSweep(
+        const ParameterSweep& sweep,
+        CameraSensor* camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces = 4,
+        int topN = 10,
+        const TraceOptions& options = TraceOptions(),
+        const std::string& cacheFilename = "",
+        const ProgressSettings& progress = ProgressSettings(),
+        const ShardSpec& shard = ShardSpec()
+    );
+    
+    // Focus curve of an evaluated configuration: the secondary at its best
+    // position, the fan traced once and the sensor swept over
+    // +/- halfRange mm along its normal
+    static FocusCurve throughFocus(
+        const BatchResult& result,
+        const CameraSensor& camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        const TraceOptions& options,
+        float halfRange,
+        int steps
+    );
+    
+    // Refine an evaluated configuration with damped least squares on the
+    // per-ray spot residuals, solving jointly for the secondary position,
+    // R and K (the axial position is the mirror spacing). The refinement
+    // minimises RMS, so the refined prescription replaces result's only if
+    // it scores at least as well on the run's own objective (EE80 runs
+    // included). On-axis 2-D fan only; 3-D and field runs are skipped.
+    static RefineOutcome refineResult(
+        BatchResult& result,
+        DampedLeastSquaresResult& refined,
+        const CameraSensor& camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        const TraceOptions& options
     );
     
-    // Save results to CSV
-    static void saveResultsToCSV(
+    // Save results to CSV. exact writes every value at full float precision
+    // (shard files), so merging them reproduces a single run's output. The
+    // file is written beside the target and renamed over it, so a reader
+    // (ResultsWatcher) never sees a partial list. False if it failed.
+    static bool saveResultsToCSV(
         const std::vector<BatchResult>& results,
-        const std::string& outputFilename
+        const std::string& outputFilename,
+        bool exact = false
     );
+    
+    // Results CSV back into BatchResults (raysTraced is not stored)
+    static std::vector<BatchResult> loadBatchResultsFromCSV(const std::string& filename);
+    
+    // Ranking order of every batch output: higher score first, ties by row
+    static bool ranksAbove(const BatchResult& a, const BatchResult& b);
+    
+    // Combine partial result files from shards into one top-N ranking. Each
+    // shard's top N holds every global top-N row of its slice, so the result
+    // is the same for any shard count or split.
+    static std::vector<BatchResult> mergeResults(const std::vector<std::string>& filenames,
+                                                 int topN);
 
 private:
+    // Fills block with rows [begin, end) of a batch's input
+    typedef std::function<void(size_t begin, size_t end, std::vector<OpticalConfig>& block)> ConfigSource;
+    
+    // Shared driver of optimizeBatch and optimizeSweep: the shard's rows,
+    // block by block, keeping the running top N
+    static std::vector<BatchResult> runBatch(
+        size_t totalRows,
+        const ConfigSource& source,
+        CameraSensor* camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        int topN,
+        const TraceOptions& options,
+        const std::string& cacheFilename,
+        const ProgressSettings& progressSettings,
+        const ShardSpec& shard
+    );
+    
+    // Surrogate screening over the rows fetch yields (runBatch's source
+    // after shard and pre-filter), fetching single rows from source by
+    // rowIndex to trace them. best gets the top N of the traced rows.
+    static ScreeningReport screenRows(
+        size_t firstRow,
+        size_t lastRow,
+        const ConfigSource& source,
+        const ConfigSource& fetch,
+        CameraSensor* camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        int topN,
+        const TraceOptions& options,
+        ResultCache& cache,
+        ProgressReporter& progress,
+        LiveResults& live,
+        std::vector<BatchResult>& best,
+        long long& raysTraced,
+        int& cachedCount
+    );
+    
+    // Cache lookups, in-block deduplication and parallel evaluation of one
+    // block; results[i] belongs to configs[i], and every row is offered to
+    // live as it is resolved. hints, if given, seed the warm start of each
+    // row instead of chaining neighbours.
+    static void evaluateBlock(
+        const std::vector<OpticalConfig>& configs,
+        CameraSensor* camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        const TraceOptions& options,
+        ResultCache& cache,
+        ProgressReporter& progress,
+        LiveResults& live,
+        std::vector<BatchResult>& results,
+        int& cachedCount,
+        const std::vector<WarmStart>* hints = nullptr
+    );
+    
+    // Ranking score and its sampling error from hits, RMS/EE80 and rmsError,
+    // treating the rays as independent samples
+    static void computeScore(BatchResult& result, int numRays, bool rankByEE);
+    
+    // Replace computeScore's errors with what the sampler supports: kept for
+    // stratified jitter, the spread over RQMC_REPLICATES random shifts for
+    // Halton and Sobol (traced with the secondary at result's best position),
+    // NaN for the deterministic fans
+    static void estimateSamplingError(
+        BatchResult& result,
+        const std::vector<std::unique_ptr<Mirror>>& mirrors,
+        const CameraSensor& camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        const TraceOptions& options
+    );
+    
+    // 3-D counterpart of TelescopeOptimizer::evaluateFields
+    static FieldEvaluation evaluateFields3D(
+        const ParabolicMirror& primary,
+        const HyperbolicMirror& secondary,
+        const CameraSensor& camera,
+        const PupilSamples& pupil,
+        float rayStartX,
+        int maxBounces,
+        const FieldSet& fields
+    );
+
+    // Warm-start search: initial half window in scan steps, and rows per
+    // chain (the first row of each chain is scanned cold)
+    static const int WARM_HALF_WINDOW = 3;
+    static const size_t WARM_CHAIN_ROWS = 32;
+    // Randomised QMC error: shifts of the sequence per result (the first is the result)
+    static const int RQMC_REPLICATES = 4;
+    // Most centres a screening surrogate is fitted on
+    static const size_t MAX_SURROGATE_CENTRES = 512;
+    
     static std::vector<std::string> splitString(const std::string& str, char delimiter);
     static float stringToFloat(const std::string& str);
 };
 
+// Running top N of a batch, offered rows by the worker threads as they
+// finish and written out on every progress report, so a ResultsWatcher
+// (the GUI) can follow a long run. Without a filename offers are ignored.
+class LiveResults {
+public:
+    LiveResults(const std::string& filename, int topN, bool exact);
+
+    // Any thread
+    void offer(const BatchResult& result);
+    // Replace the file if the top N changed since the last write
+    void write();
+
+private:
+    std::string filename;
+    int topN;
+    bool exact;  // As saveResultsToCSV
+
+    std::mutex mutex;
+    std::vector<BatchResult> best;
+    bool changed = false;
+};
+
 #endif // BATCH_OPTIMIZER_H
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "Camera.h"
 #include <cmath>
+#include <algorithm>
 
 CameraSensor::CameraSensor(sf::Vector2f c, float w, float ang, const std::string& n)
     : Mirror(n), center(c), width(w), angle(ang), drawColor(sf::Color::Cyan), 
-      totalRaysTraced(0), blockedRays(0) {}
+      totalRaysTraced(0), blockedRays(0), hitDots(sf::Quads) {}
 
 std::string CameraSensor::getType() const { 
     return "camera"; 
@@ -67,12 +68,18 @@ void CameraSensor::draw(sf::RenderWindow& window, const sf::Vector2f& offset, fl
     };
     window.draw(line, 2, sf::Lines);
     
-    for (const auto& hit : hitPoints) {
-        sf::CircleShape dot(2);
-        dot.setFillColor(sf::Color::Red);
-        dot.setPosition(offset.x + hit.x * scale - 2, offset.y - hit.y * scale - 2);
-        window.draw(dot);
+    const float dotRadius = 2.0f;
+    hitDots.resize(hitPoints.size() * 4);
+    for (size_t i = 0; i < hitPoints.size(); i++) {
+        float x = offset.x + hitPoints[i].x * scale;
+        float y = offset.y - hitPoints[i].y * scale;
+        sf::Vertex* quad = &hitDots[i * 4];
+        quad[0] = sf::Vertex(sf::Vector2f(x - dotRadius, y - dotRadius), sf::Color::Red);
+        quad[1] = sf::Vertex(sf::Vector2f(x + dotRadius, y - dotRadius), sf::Color::Red);
+        quad[2] = sf::Vertex(sf::Vector2f(x + dotRadius, y + dotRadius), sf::Color::Red);
+        quad[3] = sf::Vertex(sf::Vector2f(x - dotRadius, y + dotRadius), sf::Color::Red);
     }
+    if (!hitPoints.empty()) window.draw(hitDots);
 }
 
 float CameraSensor::getFocusSpread() const {
@@ -94,24 +101,57 @@ float CameraSensor::getFocusSpread() const {
 }
 
 float CameraSensor::getRMSSpotSize() const {
-    if (hitPoints.size() < 2) return 0.0f;
+    return computeRMSSpotSize(hitPoints);
+}
+
+float CameraSensor::computeRMSSpotSize(const std::vector<sf::Vector2f>& points) {
+    if (points.size() < 2) return 0.0f;
     
     float centerX = 0.0f, centerY = 0.0f;
-    for (const auto& hit : hitPoints) {
+    for (const auto& hit : points) {
         centerX += hit.x;
         centerY += hit.y;
     }
-    centerX /= hitPoints.size();
-    centerY /= hitPoints.size();
+    centerX /= points.size();
+    centerY /= points.size();
     
     float sumSqDist = 0.0f;
-    for (const auto& hit : hitPoints) {
+    for (const auto& hit : points) {
         float dx = hit.x - centerX;
         float dy = hit.y - centerY;
         sumSqDist += dx * dx + dy * dy;
     }
     
-    return std::sqrt(sumSqDist / hitPoints.size());
+    return std::sqrt(sumSqDist / points.size());
+}
+
+float CameraSensor::computeRMSStandardError(const std::vector<sf::Vector2f>& points) {
+    if (points.size() < 3) return 0.0f;
+    
+    double centerX = 0.0, centerY = 0.0;
+    for (const auto& hit : points) {
+        centerX += hit.x;
+        centerY += hit.y;
+    }
+    centerX /= points.size();
+    centerY /= points.size();
+    
+    double sum = 0.0, sumSq = 0.0;
+    for (const auto& hit : points) {
+        double dx = hit.x - centerX;
+        double dy = hit.y - centerY;
+        double r2 = dx * dx + dy * dy;
+        sum += r2;
+        sumSq += r2 * r2;
+    }
+    
+    double n = static_cast<double>(points.size());
+    double meanR2 = sum / n;
+    double variance = std::max(0.0, (sumSq - n * meanR2 * meanR2) / (n - 1.0));
+    double rms = std::sqrt(meanR2);
+    if (rms <= 0.0) return 0.0f;
+    
+    return static_cast<float>(std::sqrt(variance / n) / (2.0 * rms));
 }
 
 float CameraSensor::getEffectiveFocalLength(float primaryFocalLength) const {
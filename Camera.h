@@ -33,9 +33,17 @@ public:
     
     float getFocusSpread() const;
     float getRMSSpotSize() const;
+    static float computeRMSSpotSize(const std::vector<sf::Vector2f>& points);
+    // Standard error of the RMS estimate, treating hits as independent samples
+    // (delta method on the mean squared radius; conservative for stratified/QMC)
+    static float computeRMSStandardError(const std::vector<sf::Vector2f>& points);
     float getEffectiveFocalLength(float primaryFocalLength) const;
     float getAngularResolutionArcsec(float effectiveFocalLength) const;
     float getFieldOfViewArcmin(float effectiveFocalLength) const;
+
+private:
+    // Hit markers as one quad list, refilled by draw() without reallocating
+    mutable sf::VertexArray hitDots;
 };
 
 #endif // CAMERA_H
\ No newline at end of file
@@ -67,6 +67,25 @@ public:
         // Note: Camera is updated separately in main
     }
     
+    // Reshape mirrors made by buildTelescopeFromConfig to match config,
+    // without reallocating them. The secondary keeps its position; the
+    // caller moves it (the sliders own centerX/centerY).
+    static void updateTelescopeFromConfig(
+        const OpticalConfig& config,
+        ParabolicMirror& primary,
+        HyperbolicMirror& secondary
+    ) {
+        primary.focalLength = config.primaryF;
+        primary.yMax = config.primaryDiameter / 2.0f;
+        primary.yMin = -primary.yMax;
+        primary.holeRadius = config.secondaryDiameter / 2.0f;
+
+        secondary.a = std::abs(config.secondaryR) / 2.0f;
+        secondary.b = secondary.a * std::sqrt(std::abs(config.secondaryK + 1.0f));
+        secondary.yMax = config.secondaryDiameter / 2.0f;
+        secondary.yMin = -secondary.yMax;
+    }
+    
     static std::string getConfigSummary(const OpticalConfig& config) {
         std::stringstream ss;
         ss << "Primary: " << std::fixed << std::setprecision(1) 
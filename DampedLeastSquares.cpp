@@ -0,0 +1,186 @@
+#include "DampedLeastSquares.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+const int P = SecondaryParams::Count;
+typedef std::array<double, P> ParamVector;
+
+// Normal equations of the spot residuals at the current parameters
+struct Linearization {
+    int hits = 0;
+    int mismatches = 0;  // From DifferentiableTracer::traceSensorPositions
+    double rms = 0.0;
+    double JtJ[P][P] = {};
+    double Jtr[P] = {};
+};
+
+Linearization linearize(const std::vector<SecondaryDual>& u) {
+    Linearization lin;
+    lin.hits = static_cast<int>(u.size());
+    if (u.size() < 2) return lin;
+
+    SecondaryDual mean(0.0);
+    for (const auto& value : u) mean += value;
+    mean = mean / static_cast<double>(u.size());
+
+    double sumSq = 0.0;
+    for (const auto& value : u) {
+        double r = value.v - mean.v;
+        double row[P];
+        for (int j = 0; j < P; j++) row[j] = value.d[j] - mean.d[j];
+
+        sumSq += r * r;
+        for (int j = 0; j < P; j++) {
+            lin.Jtr[j] += row[j] * r;
+            for (int k = 0; k < P; k++) lin.JtJ[j][k] += row[j] * row[k];
+        }
+    }
+    lin.rms = std::sqrt(sumSq / u.size());
+    return lin;
+}
+
+// Solve the n x n system A x = b in place by Gaussian elimination with
+// partial pivoting; false if singular
+bool solve(double A[P][P], double b[P], double x[P], int n) {
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < n; r++) {
+            if (std::abs(A[r][col]) > std::abs(A[pivot][col])) pivot = r;
+        }
+        if (std::abs(A[pivot][col]) < 1e-300) return false;
+        if (pivot != col) {
+            std::swap(b[pivot], b[col]);
+            for (int c = 0; c < n; c++) std::swap(A[pivot][c], A[col][c]);
+        }
+        for (int r = col + 1; r < n; r++) {
+            double factor = A[r][col] / A[col][col];
+            for (int c = col; c < n; c++) A[r][c] -= factor * A[col][c];
+            b[r] -= factor * b[col];
+        }
+    }
+    for (int r = n - 1; r >= 0; r--) {
+        double sum = b[r];
+        for (int c = r + 1; c < n; c++) sum -= A[r][c] * x[c];
+        x[r] = sum / A[r][r];
+    }
+    return true;
+}
+
+bool isHyperbolic(const ParamVector& params) {
+    return params[SecondaryParams::Radius] > 0.0 && params[SecondaryParams::Conic] < -1.0 - 1e-4;
+}
+
+} // namespace
+
+std::array<double, SecondaryParams::Count> DampedLeastSquares::getParams(const HyperbolicMirror& secondary) {
+    ParamVector params;
+    double ratio = static_cast<double>(secondary.b) / secondary.a;
+    params[SecondaryParams::CenterX] = secondary.centerX;
+    params[SecondaryParams::CenterY] = secondary.centerY;
+    params[SecondaryParams::Radius] = 2.0 * secondary.a;
+    params[SecondaryParams::Conic] = -1.0 - ratio * ratio;
+    return params;
+}
+
+void DampedLeastSquares::setParams(HyperbolicMirror& secondary, const std::array<double, SecondaryParams::Count>& params) {
+    double a = 0.5 * params[SecondaryParams::Radius];
+    secondary.centerX = static_cast<float>(params[SecondaryParams::CenterX]);
+    secondary.centerY = static_cast<float>(params[SecondaryParams::CenterY]);
+    secondary.a = static_cast<float>(a);
+    secondary.b = static_cast<float>(a * std::sqrt(std::abs(params[SecondaryParams::Conic] + 1.0)));
+}
+
+DampedLeastSquaresResult DampedLeastSquares::optimize(
+    std::vector<std::unique_ptr<Mirror>>& mirrors,
+    const CameraSensor* camera,
+    const std::vector<float>& heights,
+    float rayStartX,
+    int maxBounces,
+    const DampedLeastSquaresSettings& settings
+) {
+    DampedLeastSquaresResult result;
+
+    HyperbolicMirror* secondary = nullptr;
+    for (auto& mirror : mirrors) {
+        if (mirror->getType() == "hyperbolic") {
+            secondary = dynamic_cast<HyperbolicMirror*>(mirror.get());
+            break;
+        }
+    }
+    if (!secondary || !camera) return result;
+
+    int freeIndex[P];
+    int numFree = 0;
+    for (int j = 0; j < P; j++) {
+        if (settings.free[j]) freeIndex[numFree++] = j;
+    }
+
+    std::vector<SecondaryDual> u;
+    auto linearizeAt = [&](const ParamVector& params) {
+        setParams(*secondary, params);
+        int mismatches = DifferentiableTracer::traceSensorPositions(mirrors, camera, heights,
+                                                                    rayStartX, maxBounces, u);
+        result.traces++;
+        Linearization lin = linearize(u);
+        lin.mismatches = mismatches;
+        return lin;
+    };
+
+    ParamVector params = getParams(*secondary);
+    Linearization current = linearizeAt(params);
+    result.startHits = current.hits;
+    result.startRMS = current.rms;
+    result.mismatches = current.mismatches;
+
+    double lambda = settings.initialDamping;
+    for (int iter = 0; iter < settings.maxIterations && numFree > 0 && current.hits >= 2 &&
+                       result.mismatches == 0; iter++) {
+        result.iterations = iter + 1;
+        bool accepted = false;
+
+        while (lambda < 1e10) {
+            // (J^T J + lambda diag(J^T J)) delta = -J^T r over the free parameters
+            double A[P][P], b[P], delta[P];
+            for (int r = 0; r < numFree; r++) {
+                for (int c = 0; c < numFree; c++) A[r][c] = current.JtJ[freeIndex[r]][freeIndex[c]];
+                A[r][r] += lambda * std::max(A[r][r], 1e-12);
+                b[r] = -current.Jtr[freeIndex[r]];
+            }
+            if (!solve(A, b, delta, numFree)) {
+                lambda *= 10.0;
+                continue;
+            }
+
+            ParamVector trialParams = params;
+            for (int r = 0; r < numFree; r++) trialParams[freeIndex[r]] += delta[r];
+
+            if (isHyperbolic(trialParams)) {
+                Linearization trial = linearizeAt(trialParams);
+                if (trial.mismatches > 0) {
+                    // Its Jacobian is biased: keep the last exact point
+                    result.mismatches = trial.mismatches;
+                    break;
+                }
+                if (trial.hits >= current.hits && trial.rms < current.rms) {
+                    double improvement = (current.rms - trial.rms) / std::max(current.rms, 1e-30);
+                    params = trialParams;
+                    current = trial;
+                    lambda = std::max(lambda * 0.1, 1e-12);
+                    accepted = improvement > 1e-9;
+                    break;
+                }
+            }
+            lambda *= 10.0;
+        }
+        if (!accepted) break;
+    }
+
+    // Leave the mirror at the best parameters found
+    setParams(*secondary, params);
+    result.params = params;
+    result.hits = current.hits;
+    result.rmsSpotSize = current.rms;
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef DAMPED_LEAST_SQUARES_H
+#define DAMPED_LEAST_SQUARES_H
+
+#include "DifferentiableTracer.h"
+#include <vector>
+#include <memory>
+#include <array>
+
+struct DampedLeastSquaresSettings {
+    // Which SecondaryParams move; the rest stay at their current values
+    std::array<bool, SecondaryParams::Count> free = {true, true, true, true};
+    int maxIterations = 30;
+    double initialDamping = 1e-3;  // Marquardt lambda, relative to diag(J^T J)
+};
+
+struct DampedLeastSquaresResult {
+    std::array<double, SecondaryParams::Count> params{};  // Final centerX, centerY, |R|, K
+    int startHits = 0;
+    double startRMS = 0.0;
+    int hits = 0;
+    double rmsSpotSize = 0.0;
+    int iterations = 0;
+    int traces = 0;  // Fan traces, including rejected trial steps
+    int mismatches = 0;  // Rays the Jacobian could not follow where it stopped early (0 = none)
+};
+
+// Lens-design style damped least squares (Levenberg-Marquardt) on the
+// secondary. The residuals are the per-ray transverse errors on the
+// sensor, u_i - mean(u), so sum(r^2) = hits * RMS^2, and the Jacobian rows
+// come from DifferentiableTracer's dual numbers (ray chunks traced in
+// parallel). Steps that lose hits, or push the surface out of the
+// hyperbolic range (|R| > 0, K < -1), are rejected and damped harder.
+// Stops as soon as a Jacobian is not exact (SpotGradient::mismatches).
+// Works on the secondary found in mirrors and leaves it at the optimum.
+class DampedLeastSquares {
+public:
+    static DampedLeastSquaresResult optimize(
+        std::vector<std::unique_ptr<Mirror>>& mirrors,
+        const CameraSensor* camera,
+        const std::vector<float>& heights,
+        float rayStartX,
+        int maxBounces = 4,
+        const DampedLeastSquaresSettings& settings = DampedLeastSquaresSettings()
+    );
+
+    // Current parameters of a secondary, and the inverse
+    static std::array<double, SecondaryParams::Count> getParams(const HyperbolicMirror& secondary);
+    static void setParams(HyperbolicMirror& secondary, const std::array<double, SecondaryParams::Count>& params);
+};
+
+#endif // DAMPED_LEAST_SQUARES_H
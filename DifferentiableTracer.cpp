@@ -0,0 +1,183 @@
+#include "DifferentiableTracer.h"
+#include "Optimizer.h"
+#include "Parallel.h"
+#include <cmath>
+
+namespace {
+
+// Secondary prescription as functions of the parameters
+template<typename T>
+struct SecondarySurface {
+    T centerX, centerY;
+    T a, b;
+    bool useLeftBranch;
+};
+
+// Reflect a ray (origin o, direction d) off the secondary and intersect the
+// sensor line; u is the hit position along the sensor from its centre.
+// Root selection mirrors HyperbolicMirror::intersect. Returns false if the
+// ray misses the surface or runs parallel to the sensor.
+template<typename T>
+bool secondaryToSensor(const SecondarySurface<T>& s, const CameraSensor& camera,
+                       double ox, double oy, double dx, double dy, T& u) {
+    T invA2 = 1.0 / (s.a * s.a);
+    T invB2 = 1.0 / (s.b * s.b);
+    T rx = ox - s.centerX;
+    T ry = oy - s.centerY;
+
+    T A = dx * dx * invA2 - dy * dy * invB2;
+    T B = 2.0 * (rx * dx * invA2 - ry * dy * invB2);
+    T C = rx * rx * invA2 - ry * ry * invB2 - 1.0;
+
+    T t;
+    if (std::abs(valueOf(A)) < EPSILON) {
+        if (std::abs(valueOf(B)) <= EPSILON) return false;
+        t = -C / B;
+    } else {
+        T discriminant = B * B - 4.0 * A * C;
+        if (valueOf(discriminant) < 0.0) return false;
+        T root = sqrt(discriminant);
+        T t1 = (-B - root) / (2.0 * A);
+        T t2 = (-B + root) / (2.0 * A);
+        if (valueOf(t1) > EPSILON && valueOf(t2) > EPSILON) {
+            bool firstIsLeft = valueOf(t1) * dx < valueOf(t2) * dx;
+            t = (firstIsLeft == s.useLeftBranch) ? t1 : t2;
+        } else if (valueOf(t1) > EPSILON) {
+            t = t1;
+        } else if (valueOf(t2) > EPSILON) {
+            t = t2;
+        } else {
+            return false;
+        }
+    }
+
+    // Hit point and unit normal (gradient of the implicit surface)
+    T px = ox + t * dx;
+    T py = oy + t * dy;
+    T nx = (px - s.centerX) * invA2;
+    T ny = -((py - s.centerY) * invB2);
+    T length = sqrt(nx * nx + ny * ny);
+    nx = nx / length;
+    ny = ny / length;
+
+    // The reflection is the same for either orientation of the normal
+    T dot = dx * nx + dy * ny;
+    T rdx = dx - 2.0 * dot * nx;
+    T rdy = dy - 2.0 * dot * ny;
+
+    const double sx = std::cos(camera.angle), sy = std::sin(camera.angle);
+    const double cnx = -sy, cny = sx;
+    T denom = rdx * cnx + rdy * cny;
+    if (std::abs(valueOf(denom)) <= EPSILON) return false;
+
+    T tc = ((camera.center.x - px) * cnx + (camera.center.y - py) * cny) / denom;
+    u = (px + tc * rdx - camera.center.x) * sx + (py + tc * rdy - camera.center.y) * sy;
+    return true;
+}
+
+} // namespace
+
+int DifferentiableTracer::traceSensorPositions(
+    const std::vector<std::unique_ptr<Mirror>>& mirrors,
+    const CameraSensor* camera,
+    const std::vector<float>& heights,
+    float rayStartX,
+    int maxBounces,
+    std::vector<SecondaryDual>& u
+) {
+    u.clear();
+
+    const ParabolicMirror* primary = nullptr;
+    const HyperbolicMirror* secondary = nullptr;
+    for (const auto& mirror : mirrors) {
+        if (!primary) primary = dynamic_cast<const ParabolicMirror*>(mirror.get());
+        if (!secondary) secondary = dynamic_cast<const HyperbolicMirror*>(mirror.get());
+    }
+    if (!primary || !secondary || !camera) return 0;
+    if (secondary->tilt != 0.0f) return static_cast<int>(heights.size());
+
+    SecondarySurface<SecondaryDual> surface;
+    surface.centerX = SecondaryDual::variable(secondary->centerX, SecondaryParams::CenterX);
+    surface.centerY = SecondaryDual::variable(secondary->centerY, SecondaryParams::CenterY);
+    double ratio = static_cast<double>(secondary->b) / secondary->a;
+    SecondaryDual radius = SecondaryDual::variable(2.0 * secondary->a, SecondaryParams::Radius);
+    SecondaryDual conic = SecondaryDual::variable(-1.0 - ratio * ratio, SecondaryParams::Conic);
+    surface.a = radius * 0.5;
+    surface.b = surface.a * sqrt(abs(conic + 1.0));
+    surface.useLeftBranch = secondary->useLeftBranch;
+
+    const float sx = std::cos(camera->angle), sy = std::sin(camera->angle);
+    std::vector<SecondaryDual> slots(heights.size());
+    std::vector<unsigned char> reached(heights.size(), 0);
+    std::vector<unsigned char> mismatched(heights.size(), 0);
+
+    parallelFor(heights.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float h = heights[i];
+            Ray ray(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
+            sf::Vector2f hitPoint;
+            if (TelescopeOptimizer::traceToSensor(ray, mirrors, camera, maxBounces, hitPoint)
+                != TraceOutcome::Hit) continue;
+
+            double hitU = (hitPoint.x - camera->center.x) * sx + (hitPoint.y - camera->center.y) * sy;
+            slots[i] = SecondaryDual(hitU);
+            reached[i] = 1;
+
+            if (ray.bounces == 2) {
+                // Primary leg does not depend on the secondary: replay it in floats
+                Ray leg(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
+                Intersection primaryHit = primary->intersect(leg);
+                SecondaryDual traced;
+                mismatched[i] = 1;
+                if (primaryHit.hit) {
+                    leg.reflect(primaryHit.point, primaryHit.normal);
+                    // Accept only if the dual path lands where the tracer did,
+                    // i.e. the ray really went primary -> secondary -> sensor
+                    if (secondaryToSensor(surface, *camera, leg.origin.x, leg.origin.y,
+                                          leg.direction.x, leg.direction.y, traced) &&
+                        std::abs(traced.v - hitU) < 1e-3) {
+                        slots[i] = traced;
+                        mismatched[i] = 0;
+                    }
+                }
+            }
+        }
+    }, 64);
+
+    int mismatches = 0;
+    for (size_t i = 0; i < heights.size(); i++) {
+        if (reached[i]) u.push_back(slots[i]);
+        mismatches += mismatched[i];
+    }
+    return mismatches;
+}
+
+SpotGradient DifferentiableTracer::evaluate(
+    const std::vector<std::unique_ptr<Mirror>>& mirrors,
+    const CameraSensor* camera,
+    const std::vector<float>& heights,
+    float rayStartX,
+    int maxBounces
+) {
+    SpotGradient result;
+    std::vector<SecondaryDual> u;
+    result.mismatches = traceSensorPositions(mirrors, camera, heights, rayStartX, maxBounces, u);
+
+    result.hits = static_cast<int>(u.size());
+    if (u.size() < 2) return result;
+
+    SecondaryDual mean(0.0);
+    for (const auto& value : u) mean += value;
+    mean = mean / static_cast<double>(u.size());
+
+    SecondaryDual sumSq(0.0);
+    for (const auto& value : u) {
+        SecondaryDual diff = value - mean;
+        sumSq += diff * diff;
+    }
+    SecondaryDual rms = sqrt(sumSq / static_cast<double>(u.size()));
+
+    result.rmsSpotSize = rms.v;
+    result.gradient = rms.d;
+    return result;
+}
@@ -0,0 +1,61 @@
+#ifndef DIFFERENTIABLE_TRACER_H
+#define DIFFERENTIABLE_TRACER_H
+
+#include "Mirror.h"
+#include "Camera.h"
+#include "Dual.h"
+#include <vector>
+#include <memory>
+#include <array>
+
+// Secondary parameters the differentiable tracer differentiates against.
+// Radius and Conic follow the repo's prescription: a = |R|/2 and
+// b = a*sqrt(|K+1|), with the hyperbola's K < -1.
+struct SecondaryParams {
+    enum Index { CenterX, CenterY, Radius, Conic, Count };
+};
+
+typedef Dual<SecondaryParams::Count> SecondaryDual;
+
+struct SpotGradient {
+    int hits = 0;
+    double rmsSpotSize = 0.0;
+    std::array<double, SecondaryParams::Count> gradient{};  // d(RMS)/d(parameter)
+    int mismatches = 0;  // Rays the dual replay could not follow; the gradient is biased if > 0
+};
+
+// RMS spot size and its exact gradient with respect to the secondary's
+// position and shape, in one pass over the fan. Each ray is traced by the
+// ordinary tracer, which decides hits, misses and obstruction; rays that
+// reach the sensor via primary and secondary then have their secondary and
+// sensor legs re-evaluated in dual numbers (forward-mode AD). Rays that
+// reach the sensor any other way do not depend on the secondary.
+// The replay models an untilted secondary only.
+class DifferentiableTracer {
+public:
+    // Position along the sensor (from its centre) of every ray that reaches
+    // it, in fan order, with derivatives. Ray chunks are traced in parallel.
+    // Returns the number of primary -> secondary rays whose dual replay did
+    // not land where the tracer did; they keep their position with zero
+    // derivative, so callers must not trust the derivatives when it is
+    // nonzero. A tilted secondary is rejected: u stays empty and every
+    // ray counts.
+    static int traceSensorPositions(
+        const std::vector<std::unique_ptr<Mirror>>& mirrors,
+        const CameraSensor* camera,
+        const std::vector<float>& heights,
+        float rayStartX,
+        int maxBounces,
+        std::vector<SecondaryDual>& u
+    );
+
+    static SpotGradient evaluate(
+        const std::vector<std::unique_ptr<Mirror>>& mirrors,
+        const CameraSensor* camera,
+        const std::vector<float>& heights,
+        float rayStartX,
+        int maxBounces = 4
+    );
+};
+
+#endif // DIFFERENTIABLE_TRACER_H
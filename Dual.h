@@ -0,0 +1,94 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <array>
+#include <cmath>
+
+// Forward-mode automatic differentiation: a value and its partial
+// derivatives with respect to N parameters, carried through arithmetic.
+// Comparisons and branches use the value only, so code written for double
+// can be instantiated with Dual<N> and returns exact first derivatives of
+// whichever smooth branch the value takes.
+template<int N>
+struct Dual {
+    double v;
+    std::array<double, N> d;
+
+    Dual(double value = 0.0) : v(value) { d.fill(0.0); }
+
+    // The i-th independent variable
+    static Dual variable(double value, int i) {
+        Dual x(value);
+        x.d[i] = 1.0;
+        return x;
+    }
+
+    Dual& operator+=(const Dual& o) {
+        v += o.v;
+        for (int i = 0; i < N; i++) d[i] += o.d[i];
+        return *this;
+    }
+    Dual& operator-=(const Dual& o) {
+        v -= o.v;
+        for (int i = 0; i < N; i++) d[i] -= o.d[i];
+        return *this;
+    }
+    Dual& operator*=(const Dual& o) {
+        for (int i = 0; i < N; i++) d[i] = d[i] * o.v + v * o.d[i];
+        v *= o.v;
+        return *this;
+    }
+    Dual& operator/=(const Dual& o) {
+        double inv = 1.0 / o.v;
+        for (int i = 0; i < N; i++) d[i] = (d[i] - v * inv * o.d[i]) * inv;
+        v *= inv;
+        return *this;
+    }
+};
+
+template<int N> inline Dual<N> operator-(Dual<N> a) {
+    a.v = -a.v;
+    for (int i = 0; i < N; i++) a.d[i] = -a.d[i];
+    return a;
+}
+
+template<int N> inline Dual<N> operator+(Dual<N> a, const Dual<N>& b) { return a += b; }
+template<int N> inline Dual<N> operator-(Dual<N> a, const Dual<N>& b) { return a -= b; }
+template<int N> inline Dual<N> operator*(Dual<N> a, const Dual<N>& b) { return a *= b; }
+template<int N> inline Dual<N> operator/(Dual<N> a, const Dual<N>& b) { return a /= b; }
+
+template<int N> inline Dual<N> operator+(Dual<N> a, double b) { a.v += b; return a; }
+template<int N> inline Dual<N> operator+(double a, Dual<N> b) { b.v += a; return b; }
+template<int N> inline Dual<N> operator-(Dual<N> a, double b) { a.v -= b; return a; }
+template<int N> inline Dual<N> operator-(double a, const Dual<N>& b) { return Dual<N>(a) - b; }
+
+template<int N> inline Dual<N> operator*(Dual<N> a, double b) {
+    a.v *= b;
+    for (int i = 0; i < N; i++) a.d[i] *= b;
+    return a;
+}
+template<int N> inline Dual<N> operator*(double a, const Dual<N>& b) { return b * a; }
+template<int N> inline Dual<N> operator/(const Dual<N>& a, double b) { return a * (1.0 / b); }
+template<int N> inline Dual<N> operator/(double a, const Dual<N>& b) { return Dual<N>(a) / b; }
+
+template<int N> inline bool operator<(const Dual<N>& a, const Dual<N>& b) { return a.v < b.v; }
+template<int N> inline bool operator>(const Dual<N>& a, const Dual<N>& b) { return a.v > b.v; }
+template<int N> inline bool operator<(const Dual<N>& a, double b) { return a.v < b; }
+template<int N> inline bool operator>(const Dual<N>& a, double b) { return a.v > b; }
+
+template<int N> inline Dual<N> sqrt(const Dual<N>& a) {
+    Dual<N> r(std::sqrt(a.v));
+    double scale = r.v > 0.0 ? 0.5 / r.v : 0.0;
+    for (int i = 0; i < N; i++) r.d[i] = a.d[i] * scale;
+    return r;
+}
+
+template<int N> inline Dual<N> abs(const Dual<N>& a) {
+    return a.v < 0.0 ? -a : a;
+}
+
+// Value of a double or a Dual, for decisions made on values only
+inline double valueOf(double x) { return x; }
+template<int N> inline double valueOf(const Dual<N>& x) { return x.v; }
+
+#endif // DUAL_H
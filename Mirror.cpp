@@ -1,5 +1,6 @@
 #include "Mirror.h"
 #include <cmath>
+#include <algorithm>
 
 // Mirror base class
 Mirror::Mirror(const std::string& n) : name(n), isActive(true) {}
@@ -92,56 +93,70 @@ Intersection ParabolicMirror::intersect(const Ray& ray) const {
     return result;
 }
 
+// Segments for a curve spanning screenLength pixels: about one vertex every
+// 3 px, rounded up to a power of two so zooming only re-tessellates when
+// the level of detail actually changes
+static int outlineSteps(float screenLength, int maxSteps) {
+    int wanted = static_cast<int>(std::ceil(std::abs(screenLength) / 3.0f));
+    int steps = 8;
+    while (steps < wanted && steps < maxSteps) steps *= 2;
+    return std::min(steps, maxSteps);
+}
+
+// World (mm, y up) to screen, with the curve's x measured from centerX
+static sf::Transform outlineTransform(const sf::Vector2f& offset, float scale, float centerX) {
+    sf::Transform transform;
+    transform.translate(offset.x + centerX * scale, offset.y);
+    transform.scale(scale, -scale);
+    return transform;
+}
+
 void ParabolicMirror::draw(sf::RenderWindow& window, const sf::Vector2f& offset, float scale) const {
     if (!isActive) return;
     
-    if (holeRadius > 0.0f) {
-        sf::VertexArray upperPart(sf::LineStrip);
-        int steps = 100;
-        for (int i = 0; i <= steps; i++) {
-            float y = holeRadius + i * (yMax - holeRadius) / steps;
-            if (y <= yMax) {
-                float x = getX(y);
-                sf::Vector2f screenPos(offset.x + x * scale, offset.y - y * scale);
-                upperPart.append(sf::Vertex(screenPos, drawColor));
-            }
-        }
-        window.draw(upperPart);
-        
-        sf::VertexArray lowerPart(sf::LineStrip);
+    int steps = holeRadius > 0.0f ? outlineSteps((yMax - holeRadius) * scale, 100)
+                                  : outlineSteps((yMax - yMin) * scale, 200);
+    std::array<float, 5> key = {focalLength, yMin, yMax, holeRadius, static_cast<float>(steps)};
+    if (outline.getVertexCount() == 0 || key != outlineKey || drawColor != outlineColor) {
+        rebuildOutline(steps);
+        outlineKey = key;
+        outlineColor = drawColor;
+    }
+    window.draw(outline, sf::RenderStates(outlineTransform(offset, scale, centerX)));
+}
+
+void ParabolicMirror::rebuildOutline(int steps) const {
+    // Everything goes into one line list so the mirror is a single draw call
+    outline.clear();
+    outline.setPrimitiveType(sf::Lines);
+    
+    auto appendCurve = [&](float y0, float y1) {
+        sf::Vector2f previous;
         for (int i = 0; i <= steps; i++) {
-            float y = yMin + i * (-holeRadius - yMin) / steps;
-            if (y >= yMin) {
-                float x = getX(y);
-                sf::Vector2f screenPos(offset.x + x * scale, offset.y - y * scale);
-                lowerPart.append(sf::Vertex(screenPos, drawColor));
+            float y = y0 + i * (y1 - y0) / steps;
+            sf::Vector2f point(getX(y) - centerX, y);
+            if (i > 0) {
+                outline.append(sf::Vertex(previous, drawColor));
+                outline.append(sf::Vertex(point, drawColor));
             }
+            previous = point;
         }
-        window.draw(lowerPart);
-        
-        float yHoleTop = holeRadius;
-        float yHoleBottom = -holeRadius;
-        float xHoleTop = getX(yHoleTop);
-        float xHoleBottom = getX(yHoleBottom);
+    };
+    
+    if (holeRadius > 0.0f) {
+        appendCurve(holeRadius, yMax);
+        appendCurve(yMin, -holeRadius);
         
-        sf::Vertex holeEdges[] = {
-            sf::Vertex(sf::Vector2f(offset.x + xHoleTop * scale, offset.y - yHoleTop * scale), sf::Color(100, 100, 100)),
-            sf::Vertex(sf::Vector2f(offset.x + (xHoleTop - 30) * scale, offset.y - yHoleTop * scale), sf::Color(100, 100, 100)),
-            sf::Vertex(sf::Vector2f(offset.x + xHoleBottom * scale, offset.y - yHoleBottom * scale), sf::Color(100, 100, 100)),
-            sf::Vertex(sf::Vector2f(offset.x + (xHoleBottom - 30) * scale, offset.y - yHoleBottom * scale), sf::Color(100, 100, 100))
-        };
-        window.draw(holeEdges, 4, sf::Lines);
+        float xHoleTop = getX(holeRadius) - centerX;
+        float xHoleBottom = getX(-holeRadius) - centerX;
+        sf::Color holeColor(100, 100, 100);
         
+        outline.append(sf::Vertex(sf::Vector2f(xHoleTop, holeRadius), holeColor));
+        outline.append(sf::Vertex(sf::Vector2f(xHoleTop - 30, holeRadius), holeColor));
+        outline.append(sf::Vertex(sf::Vector2f(xHoleBottom, -holeRadius), holeColor));
+        outline.append(sf::Vertex(sf::Vector2f(xHoleBottom - 30, -holeRadius), holeColor));
     } else {
-        sf::VertexArray parabola(sf::LineStrip);
-        int steps = 200;
-        for (int i = 0; i <= steps; i++) {
-            float y = yMin + i * (yMax - yMin) / steps;
-            float x = getX(y);
-            sf::Vector2f screenPos(offset.x + x * scale, offset.y - y * scale);
-            parabola.append(sf::Vertex(screenPos, drawColor));
-        }
-        window.draw(parabola);
+        appendCurve(yMin, yMax);
     }
 }
 
@@ -248,7 +263,7 @@ HyperbolicMirror::HyperbolicMirror(float cx, float cy, float semiMajor, float se
                                    float ymin, float ymax, bool leftBranch,
                                    const std::string& n)
     : Mirror(n), centerX(cx), centerY(cy), a(semiMajor), b(semiMinor),
-      yMin(ymin), yMax(ymax), useLeftBranch(leftBranch), 
+      yMin(ymin), yMax(ymax), useLeftBranch(leftBranch), tilt(0.0f),
       drawColor(sf::Color(255, 150, 255)) {}
 
 std::string HyperbolicMirror::getType() const { 
@@ -285,6 +300,26 @@ sf::Vector2f HyperbolicMirror::getNormal(float y) const {
 }
 
 Intersection HyperbolicMirror::intersect(const Ray& ray) const {
+    if (tilt == 0.0f) return intersectAligned(ray);
+
+    // Rotate the ray into the mirror's own frame about the vertex,
+    // intersect there and rotate the hit back; distances are unchanged
+    sf::Vector2f pivot(centerX + (useLeftBranch ? -a : a), centerY);
+    float c = std::cos(tilt), s = std::sin(tilt);
+    auto rotate = [c](const sf::Vector2f& v, float sine) {
+        return sf::Vector2f(c * v.x - sine * v.y, sine * v.x + c * v.y);
+    };
+
+    Ray local(pivot + rotate(ray.origin - pivot, -s), rotate(ray.direction, -s));
+    Intersection result = intersectAligned(local);
+    if (result.hit) {
+        result.point = pivot + rotate(result.point - pivot, s);
+        result.normal = rotate(result.normal, s);
+    }
+    return result;
+}
+
+Intersection HyperbolicMirror::intersectAligned(const Ray& ray) const {
     Intersection result;
     result.mirrorPtr = this;
     
@@ -368,13 +403,23 @@ Intersection HyperbolicMirror::intersect(const Ray& ray) const {
 void HyperbolicMirror::draw(sf::RenderWindow& window, const sf::Vector2f& offset, float scale) const {
     if (!isActive) return;
     
-    sf::VertexArray hyperbola(sf::LineStrip);
-    int steps = 200;
+    int steps = outlineSteps((yMax - yMin) * scale, 200);
+    std::array<float, 7> key = {centerY, a, b, yMin, yMax, useLeftBranch ? 1.0f : 0.0f,
+                                static_cast<float>(steps)};
+    if (outline.getVertexCount() == 0 || key != outlineKey || drawColor != outlineColor) {
+        rebuildOutline(steps);
+        outlineKey = key;
+        outlineColor = drawColor;
+    }
+    window.draw(outline, sf::RenderStates(outlineTransform(offset, scale, centerX)));
+}
+
+void HyperbolicMirror::rebuildOutline(int steps) const {
+    outline.clear();
+    outline.setPrimitiveType(sf::LineStrip);
+    
     for (int i = 0; i <= steps; i++) {
         float y = yMin + i * (yMax - yMin) / steps;
-        float x = getX(y);
-        sf::Vector2f screenPos(offset.x + x * scale, offset.y - y * scale);
-        hyperbola.append(sf::Vertex(screenPos, drawColor));
+        outline.append(sf::Vertex(sf::Vector2f(getX(y) - centerX, y), drawColor));
     }
-    window.draw(hyperbola);
-}
\ No newline at end of file
+}
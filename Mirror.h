@@ -4,6 +4,7 @@
 #include "Ray.h"
 #include <SFML/Graphics.hpp>
 #include <string>
+#include <array>
 
 // Abstract base class for all mirror types
 class Mirror {
@@ -36,6 +37,19 @@ public:
     sf::Vector2f getNormal(float y) const;
     Intersection intersect(const Ray& ray) const override;
     void draw(sf::RenderWindow& window, const sf::Vector2f& offset, float scale) const override;
+
+private:
+    // Outline tessellated in world space relative to centerX and placed on
+    // screen by a transform, so panning, zooming and moving the mirror along
+    // the axis reuse it. Rebuilt when the shape, colour or LOD step count changes.
+    mutable sf::VertexArray outline;
+    mutable std::array<float, 5> outlineKey;
+    mutable sf::Color outlineColor;
+
+    void rebuildOutline(int steps) const;
+
+    // intersect() for the untilted mirror
+    Intersection intersectAligned(const Ray& ray) const;
 };
 
 // Flat mirror
@@ -66,6 +80,7 @@ public:
     float a, b;
     float yMin, yMax;
     bool useLeftBranch;
+    float tilt;  // Rotation about the vertex (rad, counter-clockwise); traced, not drawn
     sf::Color drawColor;
 
     HyperbolicMirror(float cx, float cy, float semiMajor, float semiMinor, 
@@ -77,6 +92,17 @@ public:
     sf::Vector2f getNormal(float y) const;
     Intersection intersect(const Ray& ray) const override;
     void draw(sf::RenderWindow& window, const sf::Vector2f& offset, float scale) const override;
+
+private:
+    // Cached like ParabolicMirror's outline, relative to centerX
+    mutable sf::VertexArray outline;
+    mutable std::array<float, 7> outlineKey;
+    mutable sf::Color outlineColor;
+
+    void rebuildOutline(int steps) const;
+
+    // intersect() for the untilted mirror
+    Intersection intersectAligned(const Ray& ray) const;
 };
 
 #endif // MIRROR_H
\ No newline at end of file
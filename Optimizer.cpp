@@ -2,6 +2,33 @@
 #include <limits>
 #include <algorithm>
 #include <cmath>
+#include "Parallel.h"
+#include "PupilSampler.h"
+#include "DifferentiableTracer.h"
+#include "Prescription.h"
+
+void EarlyExitBound::add(const sf::Vector2f& point) {
+    if (hits == 0) origin = point;
+    hits++;
+    double dx = static_cast<double>(point.x) - origin.x;
+    double dy = static_cast<double>(point.y) - origin.y;
+    sumX += dx;
+    sumY += dy;
+    sumSq += dx * dx + dy * dy;
+}
+
+float EarlyExitBound::minRMS(int finalHits) const {
+    if (hits < 2 || finalHits <= 0) return 0.0f;
+    double scatter = sumSq - (sumX * sumX + sumY * sumY) / hits;
+    // Small slack so float rounding in getRMSSpotSize never flips a tie
+    return static_cast<float>(std::sqrt(std::max(0.0, scatter) / finalHits) * (1.0 - 1e-4));
+}
+
+bool EarlyExitBound::cannotBeat(int remaining, int bestHits, float bestRMS) const {
+    int reachable = maxHits(remaining);
+    if (reachable < bestHits) return true;
+    return reachable == bestHits && minRMS(reachable) >= bestRMS;
+}
 
 OptimizationResult TelescopeOptimizer::optimizeSecondaryPosition(
     std::vector<std::unique_ptr<Mirror>>& mirrors,
@@ -16,7 +43,8 @@ OptimizationResult TelescopeOptimizer::optimizeSecondaryPosition(
     float scanYMin,
     float scanYMax,
     float scanYStep,
-    int maxBounces
+    int maxBounces,
+    const FieldSet& fields
 ) {
     OptimizationResult result;
     result.maxHits = 0;
@@ -44,20 +72,28 @@ OptimizationResult TelescopeOptimizer::optimizeSecondaryPosition(
 
     for (float x = scanXMin; x <= scanXMax; x += scanXStep) {
         for (float y = scanYMin; y <= scanYMax; y += scanYStep) {
-            secondary->centerX = x;
-            secondary->centerY = y;
-            camera->clearHits();
-
-            for (int i = 0; i < numRays; i++) {
-                float h = rayYMin + i * (rayYMax - rayYMin) / (numRays - 1);
-                Ray ray(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
-                traceRay(ray, mirrors, camera, maxBounces);
+            int hits;
+            float currentRMS;
+            bool recordScan = std::abs(y) < 0.01f;
+            
+            if (fields.empty() && !recordScan) {
+                // Abandon positions that can neither raise maxHits nor beat bestRMS
+                hits = evaluatePosition(secondary, camera, mirrors, numRays,
+                                        rayStartX, rayYMin, rayYMax, x, y, maxBounces,
+                                        [&](const EarlyExitBound& bound, int remaining) {
+                    int reachable = bound.maxHits(remaining);
+                    return reachable <= result.maxHits &&
+                           (reachable < numRays / 2 || bound.minRMS(reachable) >= bestRMS);
+                });
+                if (hits < 0) continue;
+                currentRMS = camera->getRMSSpotSize();
+            } else {
+                scorePosition(secondary, camera, mirrors, numRays,
+                              rayStartX, rayYMin, rayYMax, x, y, maxBounces,
+                              fields, hits, currentRMS);
             }
 
-            int hits = camera->hitPoints.size();
-            float currentRMS = camera->getRMSSpotSize();
-
-            if (std::abs(y) < 0.01f) {
+            if (recordScan) {
                 result.scanData.push_back({x, hits});
             }
 
@@ -83,17 +119,19 @@ OptimizationResult TelescopeOptimizer::optimizeSecondaryPosition(
     if (bestHitsForRMS == 0) {
         for (float x = scanXMin; x <= scanXMax; x += scanXStep) {
             for (float y = scanYMin; y <= scanYMax; y += scanYStep) {
-                secondary->centerX = x;
-                secondary->centerY = y;
-                camera->clearHits();
-
-                for (int i = 0; i < numRays; i++) {
-                    float h = rayYMin + i * (rayYMax - rayYMin) / (numRays - 1);
-                    Ray ray(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
-                    traceRay(ray, mirrors, camera, maxBounces);
+                int hits;
+                float currentRMS;
+                if (fields.empty()) {
+                    hits = evaluatePosition(secondary, camera, mirrors, numRays,
+                                            rayStartX, rayYMin, rayYMax, x, y, maxBounces,
+                                            [&](const EarlyExitBound& bound, int remaining) {
+                        return bound.maxHits(remaining) < result.maxHits;
+                    });
+                } else {
+                    scorePosition(secondary, camera, mirrors, numRays,
+                                  rayStartX, rayYMin, rayYMax, x, y, maxBounces,
+                                  fields, hits, currentRMS);
                 }
-
-                int hits = camera->hitPoints.size();
                 if (hits == result.maxHits) {
                     result.bestSecondaryX = x;
                     result.bestSecondaryY = y;
@@ -122,6 +160,14 @@ OptimizationResult TelescopeOptimizer::optimizeSecondaryPosition(
     
     result.focusSpread = camera->getRMSSpotSize();
     
+    if (!fields.empty()) {
+        std::vector<float> heights = PupilSampler::sampleFan(SamplerSettings(), numRays,
+                                                             rayYMin, rayYMax);
+        FieldEvaluation evaluation = evaluateFields(mirrors, camera, heights,
+                                                    rayStartX, fields, maxBounces);
+        result.focusSpread = evaluation.rmsSpotSize;
+    }
+    
     secondary->centerX = originalX;
     secondary->centerY = originalY;
     
@@ -140,7 +186,8 @@ OptimizationResult TelescopeOptimizer::fineOptimize(
     float searchRadius,
     float initialStep,
     int maxIterations,
-    int maxBounces
+    int maxBounces,
+    const FieldSet& fields
 ) {
     OptimizationResult result;
     
@@ -175,11 +222,12 @@ OptimizationResult TelescopeOptimizer::fineOptimize(
             float testX = bestX + dir[0] * stepSize;
             float testY = bestY + dir[1] * stepSize;
 
-            int hits = evaluatePosition(secondary, camera, mirrors, numRays, 
-                                       rayStartX, rayYMin, rayYMax, 
-                                       testX, testY, maxBounces);
-
-            float currentRMS = camera->getRMSSpotSize();
+            int hits;
+            float currentRMS;
+            scorePosition(secondary, camera, mirrors, numRays,
+                          rayStartX, rayYMin, rayYMax,
+                          testX, testY, maxBounces,
+                          fields, hits, currentRMS);
             
             // Track best hits
             if (hits > bestHits) {
@@ -217,15 +265,176 @@ OptimizationResult TelescopeOptimizer::fineOptimize(
     }
     
     result.focusSpread = camera->getRMSSpotSize();
+    
+    if (!fields.empty()) {
+        std::vector<float> heights = PupilSampler::sampleFan(SamplerSettings(), numRays,
+                                                             rayYMin, rayYMax);
+        FieldEvaluation evaluation = evaluateFields(mirrors, camera, heights,
+                                                    rayStartX, fields, maxBounces);
+        result.focusSpread = evaluation.rmsSpotSize;
+    }
 
     return result;
 }
 
+OptimizationResult TelescopeOptimizer::gradientOptimize(
+    std::vector<std::unique_ptr<Mirror>>& mirrors,
+    CameraSensor* camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    float startX,
+    float startY,
+    float initialStep,
+    int maxIterations,
+    int maxBounces
+) {
+    OptimizationResult result;
+    result.maxHits = 0;
+    result.bestSecondaryX = startX;
+    result.bestSecondaryY = startY;
+    result.hitPercentage = 0.0f;
+    result.focusSpread = 0.0f;
+    
+    HyperbolicMirror* secondary = nullptr;
+    
+    for (auto& mirror : mirrors) {
+        if (mirror->getType() == "hyperbolic") {
+            secondary = dynamic_cast<HyperbolicMirror*>(mirror.get());
+            break;
+        }
+    }
+
+    if (!secondary || !camera || numRays < 2) {
+        return result;
+    }
+
+    std::vector<float> heights(numRays);
+    for (int i = 0; i < numRays; i++) {
+        heights[i] = rayYMin + i * (rayYMax - rayYMin) / (numRays - 1);
+    }
+
+    auto evaluate = [&](double x, double y) {
+        secondary->centerX = static_cast<float>(x);
+        secondary->centerY = static_cast<float>(y);
+        result.evaluations++;
+        return DifferentiableTracer::evaluate(mirrors, camera, heights, rayStartX, maxBounces);
+    };
+
+    double x[2] = {startX, startY};
+    SpotGradient current = evaluate(x[0], x[1]);
+    result.mismatches = current.mismatches;
+    double g[2] = {current.gradient[SecondaryParams::CenterX], current.gradient[SecondaryParams::CenterY]};
+
+    // Inverse Hessian estimate, scaled so the first step is initialStep long
+    double gradNorm = std::sqrt(g[0] * g[0] + g[1] * g[1]);
+    double h0 = gradNorm > 0.0 ? initialStep / gradNorm : 1.0;
+    double H[2][2] = {{h0, 0.0}, {0.0, h0}};
+
+    for (int iter = 0; iter < maxIterations && result.mismatches == 0; iter++) {
+        double p[2] = {-(H[0][0] * g[0] + H[0][1] * g[1]), -(H[1][0] * g[0] + H[1][1] * g[1])};
+        double slope = p[0] * g[0] + p[1] * g[1];
+        if (slope >= 0.0) {
+            // Lost descent: restart from steepest descent
+            p[0] = -g[0] * h0;
+            p[1] = -g[1] * h0;
+            slope = p[0] * g[0] + p[1] * g[1];
+            H[0][0] = H[1][1] = h0;
+            H[0][1] = H[1][0] = 0.0;
+        }
+        if (slope == 0.0) break;
+
+        // Backtracking line search; steps below float resolution of the
+        // mirror position cannot change anything
+        double alpha = 1.0;
+        double stepLength = std::sqrt(p[0] * p[0] + p[1] * p[1]);
+        bool accepted = false;
+        SpotGradient trial;
+        while (alpha * stepLength > 1e-5) {
+            trial = evaluate(x[0] + alpha * p[0], x[1] + alpha * p[1]);
+            if (trial.mismatches > 0) {
+                // A biased gradient would steer the search: stop where it was exact
+                result.mismatches = trial.mismatches;
+                break;
+            }
+            if (trial.hits >= current.hits &&
+                trial.rmsSpotSize <= current.rmsSpotSize + 1e-4 * alpha * slope) {
+                accepted = true;
+                break;
+            }
+            alpha *= 0.5;
+        }
+        if (!accepted) break;
+
+        double step[2] = {alpha * p[0], alpha * p[1]};
+        double gNew[2] = {trial.gradient[SecondaryParams::CenterX], trial.gradient[SecondaryParams::CenterY]};
+        double yk[2] = {gNew[0] - g[0], gNew[1] - g[1]};
+        double sy = step[0] * yk[0] + step[1] * yk[1];
+
+        // BFGS update of the inverse Hessian when the curvature is positive
+        if (sy > 1e-12) {
+            double Hy[2] = {H[0][0] * yk[0] + H[0][1] * yk[1], H[1][0] * yk[0] + H[1][1] * yk[1]};
+            double yHy = yk[0] * Hy[0] + yk[1] * Hy[1];
+            for (int r = 0; r < 2; r++) {
+                for (int c = 0; c < 2; c++) {
+                    H[r][c] += ((sy + yHy) * step[r] * step[c]) / (sy * sy) -
+                               (Hy[r] * step[c] + step[r] * Hy[c]) / sy;
+                }
+            }
+        }
+
+        x[0] += step[0];
+        x[1] += step[1];
+        g[0] = gNew[0];
+        g[1] = gNew[1];
+        current = trial;
+
+        if (std::sqrt(g[0] * g[0] + g[1] * g[1]) < 1e-7) break;
+    }
+
+    result.maxHits = current.hits;
+    result.bestSecondaryX = static_cast<float>(x[0]);
+    result.bestSecondaryY = static_cast<float>(x[1]);
+    result.hitPercentage = (100.0f * current.hits) / numRays;
+
+    secondary->centerX = result.bestSecondaryX;
+    secondary->centerY = result.bestSecondaryY;
+    camera->clearHits();
+    
+    for (int i = 0; i < numRays; i++) {
+        Ray ray(sf::Vector2f(rayStartX, heights[i]), sf::Vector2f(1.0f, 0.0f));
+        traceRay(ray, mirrors, camera, maxBounces);
+    }
+    
+    result.focusSpread = camera->getRMSSpotSize();
+    return result;
+}
+
 void TelescopeOptimizer::traceRay(Ray& ray, std::vector<std::unique_ptr<Mirror>>& mirrors, 
                                   CameraSensor* camera, int maxBounces) {
-    for (int bounce = 0; bounce < maxBounces; bounce++) {
+    sf::Vector2f hitPoint;
+    TraceOutcome outcome = traceToSensor(ray, mirrors, camera, maxBounces, hitPoint);
+    
+    if (camera) {
+        if (outcome == TraceOutcome::Hit) {
+            camera->hitPoints.push_back(hitPoint);
+        } else if (outcome == TraceOutcome::Blocked) {
+            camera->blockedRays++;
+        }
+    }
+    
+    if (ray.bounces >= 0 && camera) {
+        camera->totalRaysTraced++;
+    }
+}
+
+TraceOutcome TelescopeOptimizer::traceToSensor(Ray& ray, const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                               const CameraSensor* camera, int maxBounces,
+                                               sf::Vector2f& hitPoint, int firstBounce) {
+    for (int bounce = firstBounce; bounce < maxBounces; bounce++) {
         Intersection closest;
-        Mirror* hitMirror = nullptr;
+        const Mirror* hitMirror = nullptr;
         
         bool isGreenRay = (bounce >= 2);
         
@@ -250,18 +459,13 @@ void TelescopeOptimizer::traceRay(Ray& ray, std::vector<std::unique_ptr<Mirror>>
         if (closest.hit) {
             if (hitMirror == nullptr) {
                 ray.path.push_back(closest.point);
-                if (camera) {
-                    camera->hitPoints.push_back(closest.point);
-                }
-                break;
+                hitPoint = closest.point;
+                return TraceOutcome::Hit;
             }
             
             if (bounce == 0 && hitMirror->getType() == "hyperbolic") {
                 ray.bounces = -1;
-                if (camera) {
-                    camera->blockedRays++;
-                }
-                break;
+                return TraceOutcome::Blocked;
             }
             
             ray.reflect(closest.point, closest.normal);
@@ -270,9 +474,177 @@ void TelescopeOptimizer::traceRay(Ray& ray, std::vector<std::unique_ptr<Mirror>>
         }
     }
     
-    if (ray.bounces >= 0 && camera) {
-        camera->totalRaysTraced++;
+    return TraceOutcome::Missed;
+}
+
+bool TelescopeOptimizer::matchCassegrain(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                         const CameraSensor* camera, int maxBounces,
+                                         const ParabolicMirror*& primary,
+                                         const HyperbolicMirror*& secondary) {
+    primary = nullptr;
+    secondary = nullptr;
+    // Blocked, primary, secondary and sensor take three closest-hit rounds
+    if (!camera || maxBounces < 3 || mirrors.size() != 2) return false;
+
+    primary = dynamic_cast<const ParabolicMirror*>(mirrors[0].get());
+    secondary = dynamic_cast<const HyperbolicMirror*>(mirrors[1].get());
+    if (!primary || !secondary) return false;
+
+    // Light reaches a sensor behind the vertex only through the hole, so
+    // the generic search never prefers it to the primary or the secondary
+    return camera->getStart().x >= primary->centerX && camera->getEnd().x >= primary->centerX;
+}
+
+FieldEvaluation TelescopeOptimizer::evaluateFields(
+    const std::vector<std::unique_ptr<Mirror>>& mirrors,
+    const CameraSensor* camera,
+    const std::vector<float>& pupilHeights,
+    float rayStartX,
+    const FieldSet& fields,
+    int maxBounces,
+    TraceMode mode
+) {
+    FieldEvaluation evaluation;
+    evaluation.hits = 0;
+    evaluation.rmsSpotSize = 0.0f;
+    evaluation.rmsError = 0.0f;
+    const int numRays = static_cast<int>(pupilHeights.size());
+
+    std::vector<float> angles = fields.anglesArcmin;
+    if (angles.empty()) angles.push_back(0.0f);
+
+    // Aim every fan at the primary vertex so all fields share the aperture
+    float pupilX = rayStartX;
+    for (const auto& mirror : mirrors) {
+        if (mirror->getType() == "parabolic") {
+            pupilX = static_cast<const ParabolicMirror*>(mirror.get())->centerX;
+            break;
+        }
+    }
+
+    // Per-field constants computed once, shared by all rays of that field
+    size_t numFields = angles.size();
+    std::vector<sf::Vector2f> directions(numFields);
+    std::vector<float> heightShifts(numFields);
+    for (size_t f = 0; f < numFields; f++) {
+        float theta = angles[f] * static_cast<float>(M_PI) / (180.0f * 60.0f);
+        directions[f] = sf::Vector2f(std::cos(theta), std::sin(theta));
+        heightShifts[f] = -(pupilX - rayStartX) * std::tan(theta);
+    }
+
+    size_t totalRays = numFields * static_cast<size_t>(numRays);
+    std::vector<unsigned char> hitFlags(totalRays, 0);
+    std::vector<sf::Vector2f> hitPoints(totalRays);
+
+    PrescriptionTracer tracer(OpticalPrescription::fromScene(mirrors, camera, maxBounces, mode),
+                              maxBounces);
+
+    parallelFor(totalRays, [&](size_t begin, size_t end) {
+        for (size_t idx = begin; idx < end; idx++) {
+            size_t f = idx / numRays;
+            int i = static_cast<int>(idx % numRays);
+            float h = pupilHeights[i] + heightShifts[f];
+            Ray ray(sf::Vector2f(rayStartX, h), directions[f]);
+            hitFlags[idx] = tracer.trace(ray, hitPoints[idx]) == TraceOutcome::Hit;
+        }
+    });
+
+    std::vector<sf::Vector2f> fieldHits;
+    for (size_t f = 0; f < numFields; f++) {
+        fieldHits.clear();
+        for (int i = 0; i < numRays; i++) {
+            size_t idx = f * numRays + i;
+            if (hitFlags[idx]) fieldHits.push_back(hitPoints[idx]);
+        }
+
+        FieldResult field;
+        field.angleArcmin = angles[f];
+        field.hits = static_cast<int>(fieldHits.size());
+        field.rmsSpotSize = CameraSensor::computeRMSSpotSize(fieldHits);
+        field.rmsError = CameraSensor::computeRMSStandardError(fieldHits);
+        evaluation.fields.push_back(field);
     }
+
+    combineFields(fields, evaluation);
+    return evaluation;
+}
+
+void TelescopeOptimizer::combineFields(const FieldSet& fields, FieldEvaluation& evaluation) {
+    float weightSum = 0.0f;
+    float weightedHits = 0.0f;
+    float weightedRMS = 0.0f;
+    float weightedVariance = 0.0f;
+    int worstHits = std::numeric_limits<int>::max();
+    float worstRMS = 0.0f;
+    float worstRMSError = 0.0f;
+
+    for (size_t f = 0; f < evaluation.fields.size(); f++) {
+        const FieldResult& field = evaluation.fields[f];
+        float weight = f < fields.weights.size() ? fields.weights[f] : 1.0f;
+        weightSum += weight;
+        weightedHits += weight * field.hits;
+        weightedRMS += weight * field.rmsSpotSize;
+        weightedVariance += weight * weight * field.rmsError * field.rmsError;
+        worstHits = std::min(worstHits, field.hits);
+        if (field.rmsSpotSize >= worstRMS) {
+            worstRMS = field.rmsSpotSize;
+            worstRMSError = field.rmsError;
+        }
+    }
+
+    if (evaluation.fields.empty()) {
+        evaluation.hits = 0;
+        evaluation.rmsSpotSize = 0.0f;
+        evaluation.rmsError = 0.0f;
+    } else if (fields.scoring == FieldScoring::WeightedField && weightSum > 0.0f) {
+        evaluation.hits = static_cast<int>(std::lround(weightedHits / weightSum));
+        evaluation.rmsSpotSize = weightedRMS / weightSum;
+        evaluation.rmsError = std::sqrt(weightedVariance) / weightSum;
+    } else {
+        evaluation.hits = worstHits;
+        evaluation.rmsSpotSize = worstRMS;
+        evaluation.rmsError = worstRMSError;
+    }
+}
+
+void TelescopeOptimizer::scorePosition(
+    HyperbolicMirror* secondary,
+    CameraSensor* camera,
+    std::vector<std::unique_ptr<Mirror>>& mirrors,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    float testX,
+    float testY,
+    int maxBounces,
+    const FieldSet& fields,
+    int& hits,
+    float& rms
+) {
+    if (fields.empty()) {
+        hits = evaluatePosition(secondary, camera, mirrors, numRays,
+                                rayStartX, rayYMin, rayYMax,
+                                testX, testY, maxBounces);
+        rms = camera->getRMSSpotSize();
+        return;
+    }
+
+    float originalX = secondary->centerX;
+    float originalY = secondary->centerY;
+
+    secondary->centerX = testX;
+    secondary->centerY = testY;
+
+    std::vector<float> heights = PupilSampler::sampleFan(SamplerSettings(), numRays,
+                                                         rayYMin, rayYMax);
+    FieldEvaluation evaluation = evaluateFields(mirrors, camera, heights,
+                                                rayStartX, fields, maxBounces);
+    hits = evaluation.hits;
+    rms = evaluation.rmsSpotSize;
+
+    secondary->centerX = originalX;
+    secondary->centerY = originalY;
 }
 
 int TelescopeOptimizer::evaluatePosition(
@@ -285,7 +657,8 @@ int TelescopeOptimizer::evaluatePosition(
     float rayYMax,
     float testX,
     float testY,
-    int maxBounces
+    int maxBounces,
+    const EarlyExitCheck& shouldAbort
 ) {
     float originalX = secondary->centerX;
     float originalY = secondary->centerY;
@@ -294,16 +667,140 @@ int TelescopeOptimizer::evaluatePosition(
     secondary->centerY = testY;
     camera->clearHits();
 
-    for (int i = 0; i < numRays; i++) {
-        float h = rayYMin + i * (rayYMax - rayYMin) / (numRays - 1);
-        Ray ray(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
-        traceRay(ray, mirrors, camera, maxBounces);
+    std::vector<float> heights = PupilSampler::sampleFan(SamplerSettings(), numRays,
+                                                         rayYMin, rayYMax);
+    // A symmetric setup only needs the upper half of the fan
+    std::vector<float> halfHeights;
+    std::vector<int> weights;
+    if (isAxiallySymmetric(mirrors, camera) &&
+        foldSymmetricFan(heights, halfHeights, weights)) {
+        heights.swap(halfHeights);
     }
 
-    int hits = camera->hitPoints.size();
+    bool aborted = false;
+    traceFan(mirrors, camera, heights, weights, rayStartX, maxBounces, shouldAbort, aborted);
+
+    int hits = aborted ? -1 : static_cast<int>(camera->hitPoints.size());
 
     secondary->centerX = originalX;
     secondary->centerY = originalY;
 
     return hits;
-}
\ No newline at end of file
+}
+
+bool TelescopeOptimizer::isAxiallySymmetric(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                            const CameraSensor* camera) {
+    const float tolerance = 1e-4f;
+
+    // A line segment maps onto itself if it is centred on the axis and
+    // either perpendicular or parallel to it
+    auto segmentSymmetric = [tolerance](const sf::Vector2f& center, float angle, float length) {
+        float dx = 0.5f * length * std::cos(angle);
+        float dy = 0.5f * length * std::sin(angle);
+        return std::abs(center.y) <= tolerance &&
+               (std::abs(dx) <= tolerance || std::abs(dy) <= tolerance);
+    };
+
+    for (const auto& mirror : mirrors) {
+        if (auto parabolic = dynamic_cast<const ParabolicMirror*>(mirror.get())) {
+            if (std::abs(parabolic->yMin + parabolic->yMax) > tolerance) return false;
+        } else if (auto hyperbolic = dynamic_cast<const HyperbolicMirror*>(mirror.get())) {
+            if (std::abs(hyperbolic->centerY) > tolerance || hyperbolic->tilt != 0.0f ||
+                std::abs(hyperbolic->yMin + hyperbolic->yMax) > tolerance) return false;
+        } else if (auto flat = dynamic_cast<const FlatMirror*>(mirror.get())) {
+            if (!segmentSymmetric(flat->center, flat->angle, flat->size)) return false;
+        } else if (auto sensor = dynamic_cast<const CameraSensor*>(mirror.get())) {
+            if (!segmentSymmetric(sensor->center, sensor->angle, sensor->width)) return false;
+        } else {
+            return false;  // Unknown surface: assume nothing
+        }
+    }
+
+    return !camera || segmentSymmetric(camera->center, camera->angle, camera->width);
+}
+
+bool TelescopeOptimizer::foldSymmetricFan(const std::vector<float>& heights,
+                                          std::vector<float>& halfHeights,
+                                          std::vector<int>& weights) {
+    const float tolerance = 1e-4f;
+    size_t n = heights.size();
+    halfHeights.clear();
+    weights.clear();
+
+    for (size_t i = 0; i < n / 2; i++) {
+        if (std::abs(heights[i] + heights[n - 1 - i]) > tolerance) {
+            halfHeights.clear();
+            weights.clear();
+            return false;
+        }
+        halfHeights.push_back(std::abs(heights[n - 1 - i]));
+        weights.push_back(2);
+    }
+    if (n % 2 == 1) {
+        if (std::abs(heights[n / 2]) > tolerance) {
+            halfHeights.clear();
+            weights.clear();
+            return false;
+        }
+        halfHeights.push_back(0.0f);
+        weights.push_back(1);
+    }
+    return n > 0;
+}
+
+int TelescopeOptimizer::traceFan(
+    const std::vector<std::unique_ptr<Mirror>>& mirrors,
+    CameraSensor* camera,
+    const std::vector<float>& heights,
+    const std::vector<int>& weights,
+    float rayStartX,
+    int maxBounces,
+    const EarlyExitCheck& shouldAbort,
+    bool& aborted,
+    TraceMode mode
+) {
+    aborted = false;
+    int remaining = 0;
+    for (size_t i = 0; i < heights.size(); i++) {
+        remaining += weights.empty() ? 1 : weights[i];
+    }
+
+    EarlyExitBound bound;
+    int traced = 0;
+
+    PrescriptionTracer tracer(OpticalPrescription::fromScene(mirrors, camera, maxBounces, mode),
+                              maxBounces);
+
+    for (size_t i = 0; i < heights.size(); i++) {
+        int weight = weights.empty() ? 1 : weights[i];
+        Ray ray(sf::Vector2f(rayStartX, heights[i]), sf::Vector2f(1.0f, 0.0f));
+        sf::Vector2f hitPoint;
+        TraceOutcome outcome = tracer.trace(ray, hitPoint);
+        traced++;
+        remaining -= weight;
+
+        if (camera) {
+            if (outcome == TraceOutcome::Hit) {
+                camera->hitPoints.push_back(hitPoint);
+                if (weight == 2) {
+                    camera->hitPoints.push_back(sf::Vector2f(hitPoint.x, -hitPoint.y));
+                }
+            } else if (outcome == TraceOutcome::Blocked) {
+                camera->blockedRays += weight;
+            }
+            if (ray.bounces >= 0) camera->totalRaysTraced += weight;
+        }
+
+        if (shouldAbort && camera) {
+            while (bound.hits < static_cast<int>(camera->hitPoints.size())) {
+                bound.add(camera->hitPoints[bound.hits]);
+            }
+            if (traced % EARLY_EXIT_CHUNK == 0 && shouldAbort(bound, remaining)) {
+                aborted = true;
+                break;
+            }
+        }
+    }
+
+    return traced;
+}
@@ -7,6 +7,74 @@
 #include <vector>
 #include <memory>
 #include <utility>
+#include <functional>
+
+// Outcome of tracing one ray through the system to the sensor
+enum class TraceOutcome {
+    Missed,
+    Blocked,  // Stopped by the secondary on the way in
+    Hit
+};
+
+// How traceFan and evaluateFields trace a scene (see Prescription.h)
+enum class TraceMode {
+    Sequential,    // The scene's sequential prescription when it has one
+    NonSequential  // Always the full closest-hit search
+};
+
+enum class FieldScoring {
+    WorstField,     // Score on the worst field's RMS / hits
+    WeightedField   // Score on the weighted mean over fields
+};
+
+// Field angles (arcmin, meridional plane) evaluated together for one position.
+// An empty set means the classic single on-axis fan.
+struct FieldSet {
+    std::vector<float> anglesArcmin;
+    std::vector<float> weights;  // Optional, one per angle (WeightedField)
+    FieldScoring scoring = FieldScoring::WorstField;
+
+    bool empty() const { return anglesArcmin.empty(); }
+};
+
+struct FieldResult {
+    float angleArcmin;
+    int hits;
+    float rmsSpotSize;
+    float rmsError;      // Standard error of rmsSpotSize
+};
+
+struct FieldEvaluation {
+    int hits;            // Combined according to FieldSet::scoring
+    float rmsSpotSize;   // Combined according to FieldSet::scoring
+    float rmsError;      // Standard error of the combined RMS
+    std::vector<FieldResult> fields;
+};
+
+// Running statistics of a partially traced evaluation, used to bound the
+// final hit count and RMS so losing candidates can be abandoned early
+struct EarlyExitBound {
+    int hits = 0;
+    sf::Vector2f origin;  // First hit; sums are taken relative to it for precision
+    double sumX = 0.0, sumY = 0.0, sumSq = 0.0;
+
+    void add(const sf::Vector2f& point);
+
+    // Most hits still reachable with `remaining` rays left to trace
+    int maxHits(int remaining) const { return hits + remaining; }
+
+    // Lower bound on the final RMS if the evaluation ends with finalHits hits:
+    // the scatter of the hits seen so far can only grow as hits are added
+    float minRMS(int finalHits) const;
+
+    // True when the candidate can no longer beat (bestHits, bestRMS) under
+    // "more hits first, then strictly smaller RMS" ranking
+    bool cannotBeat(int remaining, int bestHits, float bestRMS) const;
+};
+
+// Called every EARLY_EXIT_CHUNK rays with the running bound and rays left
+typedef std::function<bool(const EarlyExitBound&, int)> EarlyExitCheck;
+const int EARLY_EXIT_CHUNK = 32;
 
 struct OptimizationResult {
     float bestSecondaryX;
@@ -15,6 +83,8 @@ struct OptimizationResult {
     float hitPercentage;
     float focusSpread;
     std::vector<std::pair<float, int>> scanData;
+    int evaluations = 0;  // Fan traces used (gradientOptimize)
+    int mismatches = 0;   // gradientOptimize stopped on rays its gradient could not follow
 };
 
 class TelescopeOptimizer {
@@ -32,7 +102,8 @@ public:
         float scanYMin = -20.0f,
         float scanYMax = 20.0f,
         float scanYStep = 5.0f,
-        int maxBounces = 4
+        int maxBounces = 4,
+        const FieldSet& fields = FieldSet()
     );
 
     static OptimizationResult fineOptimize(
@@ -47,13 +118,117 @@ public:
         float searchRadius = 20.0f,
         float initialStep = 0.5f,
         int maxIterations = 10000000,
+        int maxBounces = 4,
+        const FieldSet& fields = FieldSet()
+    );
+
+    // Quasi-Newton (BFGS) descent of the on-axis RMS over the secondary
+    // position, using exact gradients from DifferentiableTracer. A step is
+    // accepted only if it keeps every hit and satisfies the Armijo condition;
+    // the first step moves about initialStep mm. Typically converges in tens
+    // of fan traces where fineOptimize needs thousands. Stops where the
+    // gradient stops being exact (SpotGradient::mismatches, a tilted
+    // secondary) and reports the count.
+    static OptimizationResult gradientOptimize(
+        std::vector<std::unique_ptr<Mirror>>& mirrors,
+        CameraSensor* camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        float startX,
+        float startY,
+        float initialStep = 0.5f,
+        int maxIterations = 50,
         int maxBounces = 4
     );
 
+    // Trace one ray without touching the camera's hit list (safe to call
+    // concurrently) by closest-hit search over every mirror and the camera;
+    // hitPoint is set when the outcome is Hit. A ray that
+    // already made firstBounce reflections resumes from that bounce.
+    static TraceOutcome traceToSensor(Ray& ray, const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                      const CameraSensor* camera, int maxBounces,
+                                      sf::Vector2f& hitPoint, int firstBounce = 0);
+
+    // Primary and secondary of a scene the compiled CassegrainPath (see
+    // SequentialTracer.h) traces with the same outcomes as traceToSensor:
+    // exactly a parabolic primary and a hyperbolic secondary, the sensor
+    // behind the primary vertex, and enough bounces for the full path.
+    // False for any other scene, which keeps the generic tracer.
+    static bool matchCassegrain(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                const CameraSensor* camera, int maxBounces,
+                                const ParabolicMirror*& primary,
+                                const HyperbolicMirror*& secondary);
+
+    // Trace every field's fan in one parallel pass over the current mirror
+    // setup. Off-axis fans are centred on the primary vertex so each field
+    // fills the same aperture.
+    // pupilHeights are the launch heights of the on-axis fan (see PupilSampler).
+    static FieldEvaluation evaluateFields(
+        const std::vector<std::unique_ptr<Mirror>>& mirrors,
+        const CameraSensor* camera,
+        const std::vector<float>& pupilHeights,
+        float rayStartX,
+        const FieldSet& fields,
+        int maxBounces = 4,
+        TraceMode mode = TraceMode::Sequential
+    );
+
+    // Reduce evaluation.fields to the combined hits/RMS per fields.scoring
+    static void combineFields(const FieldSet& fields, FieldEvaluation& evaluation);
+
+    // True when every mirror and the camera are mirror images of themselves
+    // about the optical axis (y = 0): apertures, holes and sensor centred
+    static bool isAxiallySymmetric(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                   const CameraSensor* camera);
+
+    // Fold a fan that is symmetric about h = 0 onto its upper half. Each
+    // kept height has weight 2 (itself and its mirror image), an on-axis ray
+    // weight 1. Returns false if the fan is not symmetric.
+    static bool foldSymmetricFan(const std::vector<float>& heights,
+                                 std::vector<float>& halfHeights,
+                                 std::vector<int>& weights);
+
+    // Trace an on-axis fan into the camera's hit list. A ray of weight 2 also
+    // records its mirror image (x, -y) for the untraced ray at -h; empty
+    // weights means every ray counts once. shouldAbort is polled every
+    // EARLY_EXIT_CHUNK rays with the weight still left to trace.
+    // Returns the number of rays actually traced.
+    static int traceFan(
+        const std::vector<std::unique_ptr<Mirror>>& mirrors,
+        CameraSensor* camera,
+        const std::vector<float>& heights,
+        const std::vector<int>& weights,
+        float rayStartX,
+        int maxBounces,
+        const EarlyExitCheck& shouldAbort,
+        bool& aborted,
+        TraceMode mode = TraceMode::Sequential
+    );
+
 private:
     static void traceRay(Ray& ray, std::vector<std::unique_ptr<Mirror>>& mirrors, 
                         CameraSensor* camera, int maxBounces);
 
+    // Hits and RMS at one secondary position: the on-axis fan through the
+    // camera when fields is empty, otherwise the combined field score
+    static void scorePosition(
+        HyperbolicMirror* secondary,
+        CameraSensor* camera,
+        std::vector<std::unique_ptr<Mirror>>& mirrors,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        float testX,
+        float testY,
+        int maxBounces,
+        const FieldSet& fields,
+        int& hits,
+        float& rms
+    );
+
     static int evaluatePosition(
         HyperbolicMirror* secondary,
         CameraSensor* camera,
@@ -64,7 +239,8 @@ private:
         float rayYMax,
         float testX,
         float testY,
-        int maxBounces
+        int maxBounces,
+        const EarlyExitCheck& shouldAbort = nullptr  // Returns -1 if aborted
     );
 };
 
@@ -0,0 +1,58 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Number of worker threads used by the parallel tracing paths
+inline unsigned workerThreadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+// True on threads that already run one slice of a parallel loop. Nested
+// parallel loops on such threads run inline instead of oversubscribing.
+inline bool& inParallelWorker() {
+    thread_local bool inside = false;
+    return inside;
+}
+
+// Split [0, count) into contiguous chunks and run body(begin, end) on each
+// chunk from its own thread. Small ranges, and loops nested inside another
+// parallel loop, run inline on the calling thread.
+template<typename Func>
+void parallelFor(size_t count, Func body, size_t minChunk = 256) {
+    if (count == 0) return;
+
+    size_t maxThreads = workerThreadCount();
+    size_t numThreads = std::min(maxThreads, (count + minChunk - 1) / minChunk);
+    if (numThreads <= 1 || inParallelWorker()) {
+        body(static_cast<size_t>(0), count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(numThreads - 1);
+    size_t chunk = (count + numThreads - 1) / numThreads;
+
+    for (size_t t = 1; t < numThreads; t++) {
+        size_t begin = t * chunk;
+        size_t end = std::min(count, begin + chunk);
+        if (begin >= end) break;
+        workers.emplace_back([&body, begin, end]() {
+            inParallelWorker() = true;
+            body(begin, end);
+        });
+    }
+    inParallelWorker() = true;
+    body(static_cast<size_t>(0), std::min(count, chunk));
+    inParallelWorker() = false;
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,162 @@
+#include "ParameterSweep.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <limits>
+
+size_t SweepAxis::count() const {
+    if (step <= 0.0) return 1;
+    // Tolerate stop values that a decimal step misses by rounding
+    return static_cast<size_t>(std::floor((stop - start) / step + 1e-6)) + 1;
+}
+
+ParameterSweep::ParameterSweep() {
+    // Defaults: the 8" f/8 primary and 35 mm secondary of the example grid
+    axes = {
+        {"primaryDiameter", 203.2, 203.2, 0.0},
+        {"secondaryDiameter", 35.0, 35.0, 0.0},
+        {"primaryF", 1625.6, 1625.6, 0.0},
+        {"primaryK", -1.0, -1.0, 0.0},
+        {"secondaryR", -500.0, -500.0, 0.0},
+        {"secondaryK", -2.0, -2.0, 0.0},
+        {"mirrorSeparation", 360.0, 360.0, 0.0},
+    };
+}
+
+bool ParameterSweep::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open sweep spec " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::string error;
+        if (!parseLine(line, error)) {
+            std::cerr << "Error: " << filename << ":" << lineNumber << ": " << error << std::endl;
+            return false;
+        }
+    }
+
+    // Row numbers are stored as OpticalConfig::rowIndex
+    double rows = 1.0;
+    for (const auto& axis : axes) rows *= axis.count();
+    if (rows > std::numeric_limits<int>::max()) {
+        std::cerr << "Error: sweep " << filename << " has " << rows
+                  << " configurations, more than a run can index" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ParameterSweep::parseLine(const std::string& line, std::string& error) {
+    std::string text = line.substr(0, line.find('#'));
+    if (text.find_first_not_of(" \t\r") == std::string::npos) return true;
+
+    size_t equals = text.find('=');
+    if (equals == std::string::npos) {
+        error = "expected name = value or name = start:stop:step";
+        return false;
+    }
+
+    std::stringstream nameStream(text.substr(0, equals));
+    std::string name;
+    nameStream >> name;
+
+    SweepAxis* axis = nullptr;
+    for (auto& candidate : axes) {
+        if (candidate.name == name) axis = &candidate;
+    }
+    if (!axis) {
+        error = "unknown parameter '" + name + "' (derived fields are computed)";
+        return false;
+    }
+
+    std::vector<double> values;
+    std::stringstream valueStream(text.substr(equals + 1));
+    std::string token;
+    try {
+        while (std::getline(valueStream, token, ':')) values.push_back(std::stod(token));
+    } catch (...) {
+        error = "bad number in '" + text.substr(equals + 1) + "'";
+        return false;
+    }
+
+    if (values.size() == 1) {
+        axis->start = axis->stop = values[0];
+        axis->step = 0.0;
+    } else if (values.size() == 3 && values[2] > 0.0 && values[1] >= values[0]) {
+        axis->start = values[0];
+        axis->stop = values[1];
+        axis->step = values[2];
+    } else {
+        error = "expected value or start:stop:step with step > 0 and stop >= start";
+        return false;
+    }
+    return true;
+}
+
+size_t ParameterSweep::size() const {
+    size_t rows = 1;
+    for (const auto& axis : axes) rows *= axis.count();
+    return rows;
+}
+
+OpticalConfig ParameterSweep::at(size_t row) const {
+    float values[7];
+    size_t rest = row;
+    for (size_t a = axes.size(); a-- > 0;) {
+        size_t n = axes[a].count();
+        values[a] = axes[a].value(rest % n);
+        rest /= n;
+    }
+
+    OpticalConfig config;
+    config.primaryDiameter = values[0];
+    config.secondaryDiameter = values[1];
+    config.primaryF = values[2];
+    config.primaryK = values[3];
+    config.secondaryR = values[4];
+    config.secondaryK = values[5];
+    config.mirrorSeparation = values[6];
+    config.primaryR = 2.0f * config.primaryF;
+    config.secondaryF = config.secondaryR / 2.0f;
+    config.systemFocalLength = paraxialFocalLength(config);
+    config.rowIndex = static_cast<int>(row);
+
+    config.bestSecondaryX = 0.0f;
+    config.bestSecondaryY = 0.0f;
+    config.cameraHits = 0;
+    config.hitPercentage = 0.0f;
+    config.rmsSpotSize = 0.0f;
+    config.score = 0.0f;
+    return config;
+}
+
+std::string ParameterSweep::describe() const {
+    std::stringstream ss;
+    bool any = false;
+    for (const auto& axis : axes) {
+        if (axis.count() <= 1) continue;
+        ss << (any ? " x " : "") << axis.name << " " << axis.count();
+        any = true;
+    }
+    if (!any) ss << "single point";
+    ss << " = " << size() << " configurations";
+    return ss.str();
+}
+
+float ParameterSweep::paraxialFocalLength(const OpticalConfig& config) {
+    // The convention the grid CSVs (small/, big/) were generated with: the
+    // secondary (focal length h = |R|/2) magnifies the prime focus by
+    // m = h / (h - mirrorSeparation). Sweep rows and grid rows of the same
+    // geometry therefore carry the same systemFocalLength, sign included.
+    double halfR = std::abs(config.secondaryR) / 2.0;
+    double denominator = halfR - config.mirrorSeparation;
+    if (std::abs(denominator) < 1e-6) return 0.0f;
+    return static_cast<float>(config.primaryF * halfR / denominator);
+}
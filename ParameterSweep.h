@@ -0,0 +1,58 @@
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+
+#include "BatchOptimizer.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// One independent parameter of a sweep: start, start + step, ... up to stop
+struct SweepAxis {
+    std::string name;
+    double start;
+    double stop;
+    double step;  // 0 for a fixed value
+
+    size_t count() const;
+    float value(size_t i) const { return static_cast<float>(start + i * step); }
+};
+
+// Cartesian product of OpticalConfig's independent parameters, built into
+// batch_optimize instead of an external grid CSV. Configurations are
+// decoded from their row number on demand (mixed radix, last axis fastest),
+// so nothing is materialised and any row can be produced by any worker.
+//
+// Spec file, one parameter per line, '#' starts a comment:
+//     primaryF = 1625.6:2032:406.4     # start:stop:step
+//     secondaryK = -2.2:-1.8:0.1
+//     primaryDiameter = 203.2          # fixed value
+// Parameters not given keep their defaults. The derived fields are
+// computed: primaryR = 2 primaryF, secondaryF = secondaryR / 2, and
+// systemFocalLength is the paraxial focal length of the pair in the
+// grid CSVs' convention.
+class ParameterSweep {
+public:
+    ParameterSweep();
+
+    // Read a spec file; errors go to cerr and return false
+    bool load(const std::string& filename);
+    // One "name = value" or "name = start:stop:step" line
+    bool parseLine(const std::string& line, std::string& error);
+
+    size_t size() const;
+    OpticalConfig at(size_t row) const;
+
+    const std::vector<SweepAxis>& getAxes() const { return axes; }
+    // e.g. "primaryF 2 x secondaryR 3 x secondaryK 5 = 30 configurations"
+    std::string describe() const;
+
+    // Paraxial effective focal length of the primary and secondary, as the
+    // grid CSVs compute it: primaryF h / (h - mirrorSeparation), h = |R|/2
+    // (0 if the pair has no finite focus)
+    static float paraxialFocalLength(const OpticalConfig& config);
+
+private:
+    std::vector<SweepAxis> axes;  // Fixed order, one per independent parameter
+};
+
+#endif // PARAMETER_SWEEP_H
@@ -0,0 +1,169 @@
+#include "Prefilter.h"
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+
+namespace {
+
+// The fields the checks read, one column each
+struct ConfigColumns {
+    std::vector<float> primaryDiameter, secondaryDiameter, primaryR, secondaryR;
+    std::vector<float> primaryF, secondaryF, secondaryK, mirrorSeparation, systemFocalLength;
+
+    void load(const std::vector<OpticalConfig>& configs) {
+        size_t n = configs.size();
+        std::vector<float>* columns[] = {&primaryDiameter, &secondaryDiameter, &primaryR, &secondaryR,
+                                         &primaryF, &secondaryF, &secondaryK, &mirrorSeparation,
+                                         &systemFocalLength};
+        for (auto* column : columns) column->resize(n);
+        for (size_t i = 0; i < n; i++) {
+            const OpticalConfig& c = configs[i];
+            primaryDiameter[i] = c.primaryDiameter;
+            secondaryDiameter[i] = c.secondaryDiameter;
+            primaryR[i] = c.primaryR;
+            secondaryR[i] = c.secondaryR;
+            primaryF[i] = c.primaryF;
+            secondaryF[i] = c.secondaryF;
+            secondaryK[i] = c.secondaryK;
+            mirrorSeparation[i] = c.mirrorSeparation;
+            systemFocalLength[i] = c.systemFocalLength;
+        }
+    }
+};
+
+// x - x is 0 only for finite x; no library call, so the loop still vectorises
+inline bool finite(float x) { return x - x == 0.0f; }
+
+// Grid CSVs round to a few decimals, so R = 2f only holds to that precision
+inline bool mismatch(float r, float f) {
+    return std::abs(r - 2.0f * f) > 0.02f + 1e-4f * std::abs(r);
+}
+
+}  // namespace
+
+void ConfigPrefilter::classify(const std::vector<OpticalConfig>& configs,
+                               std::vector<unsigned char>& failures) {
+    ConfigColumns cols;
+    cols.load(configs);
+    const size_t n = configs.size();
+    failures.assign(n, 0);
+
+    const float scan = BatchOptimizer::SCAN_HALF_RANGE;
+    const float margin = BatchOptimizer::HOLE_MARGIN;
+    const float focalTolerance = 0.02f;  // Relative, on |systemFocalLength|
+
+    for (size_t i = 0; i < n; i++) {
+        float d1 = cols.primaryDiameter[i], d2 = cols.secondaryDiameter[i];
+        float f1 = cols.primaryF[i], r2 = cols.secondaryR[i];
+        float k2 = cols.secondaryK[i], sep = cols.mirrorSeparation[i];
+        float target = std::abs(cols.systemFocalLength[i]);
+
+        bool allFinite = finite(d1) & finite(d2) & finite(cols.primaryR[i]) & finite(r2) &
+                         finite(f1) & finite(cols.secondaryF[i]) & finite(k2) & finite(sep) &
+                         finite(cols.systemFocalLength[i]);
+        bool nonPhysical = !allFinite | (d1 <= 0.0f) | (d2 <= 0.0f) | (f1 <= 0.0f) | (r2 == 0.0f);
+        bool focalMismatch = mismatch(cols.primaryR[i], f1) | mismatch(r2, cols.secondaryF[i]);
+        bool wrongConic = k2 >= -1.0f;
+        bool obstructed = d2 / 2.0f + margin >= d1 / 2.0f;
+
+        // Paraxial pair with the secondary placed as buildSystem places it:
+        // the secondary (focal length h = |R|/2) has its vertex p = s - h
+        // inside the prime focus when its centre is s past it, and images the
+        // prime focus q = p h / (h - p) in front of that vertex. The back
+        // focal distance p + q - f1 grows with s, so the far end of the scan
+        // decides whether the image ever lands behind the primary.
+        float h = std::abs(r2) / 2.0f;
+        float sLo = sep - scan, sHi = sep + scan;
+        float pMax = sHi - h;
+        float qMax = pMax * h / (h - pMax);
+        bool reachesInfinity = sHi >= 2.0f * h;
+        bool noRealFocus = !reachesInfinity & !((pMax > 0.0f) & (pMax + qMax - f1 > 0.0f));
+
+        // systemFocalLength in the model the grids were generated with
+        // (ParameterSweep::paraxialFocalLength): f1 h / (h - s), monotonic on
+        // either side of its pole at s = h, so a scan across the pole
+        // reaches any length
+        float efl1 = std::abs(f1 * h / (h - sLo));
+        float efl2 = std::abs(f1 * h / (h - sHi));
+        bool crossesPole = (sLo < h) & (sHi > h);
+        bool inRange = (target >= std::min(efl1, efl2) * (1.0f - focalTolerance)) &
+                       (target <= std::max(efl1, efl2) * (1.0f + focalTolerance));
+        bool offTarget = (target > 0.0f) & !crossesPole & !inRange;
+
+        failures[i] = static_cast<unsigned char>((nonPhysical << NonPhysical) |
+                                                 (focalMismatch << FocalMismatch) |
+                                                 (wrongConic << WrongConic) |
+                                                 (obstructed << Obstructed) |
+                                                 (noRealFocus << NoRealFocus) |
+                                                 (offTarget << FocalLengthOffTarget));
+    }
+}
+
+size_t ConfigPrefilter::apply(std::vector<OpticalConfig>& configs, PrefilterMode mode,
+                              PrefilterStats& stats) {
+    if (mode == PrefilterMode::Off) return 0;
+
+    std::vector<unsigned char> failures;
+    classify(configs, failures);
+
+    unsigned char mask = rejectMask(mode);
+    size_t kept = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        for (int reason = 0; reason < PREFILTER_REASONS; reason++) {
+            stats.failed[reason] += (failures[i] >> reason) & 1;
+        }
+        if (!(failures[i] & mask)) configs[kept++] = configs[i];
+    }
+
+    size_t removed = configs.size() - kept;
+    stats.checked += configs.size();
+    stats.rejected += removed;
+    configs.resize(kept);
+    return removed;
+}
+
+unsigned char ConfigPrefilter::rejectMask(PrefilterMode mode) {
+    unsigned char standard = (1 << NonPhysical) | (1 << FocalMismatch) |
+                             (1 << WrongConic) | (1 << Obstructed);
+    switch (mode) {
+        case PrefilterMode::Off: return 0;
+        case PrefilterMode::Standard: return standard;
+        case PrefilterMode::Strict: return (1 << PREFILTER_REASONS) - 1;
+    }
+    return standard;
+}
+
+const char* ConfigPrefilter::reasonName(int reason) {
+    switch (reason) {
+        case NonPhysical: return "non-physical";
+        case FocalMismatch: return "R/f mismatch";
+        case WrongConic: return "secondary not hyperbolic";
+        case Obstructed: return "fully obstructed";
+        case NoRealFocus: return "no real focus";
+        case FocalLengthOffTarget: return "focal length unreachable";
+    }
+    return "unknown";
+}
+
+std::string PrefilterStats::summary(PrefilterMode mode) const {
+    unsigned char mask = ConfigPrefilter::rejectMask(mode);
+    std::stringstream ss;
+    ss << "Pre-filter: rejected " << rejected << " of " << checked;
+
+    // Counts per reason, the rejecting ones first, then those only flagged
+    for (int pass = 0; pass < 2; pass++) {
+        bool rejecting = pass == 0;
+        bool any = false;
+        for (int reason = 0; reason < PREFILTER_REASONS; reason++) {
+            if (failed[reason] == 0 || (((mask >> reason) & 1) != 0) != rejecting) continue;
+            if (!any) {
+                if (!rejecting) ss << "; flagged";
+                ss << " (";
+            }
+            ss << (any ? ", " : "") << ConfigPrefilter::reasonName(reason) << " " << failed[reason];
+            any = true;
+        }
+        if (any) ss << ")";
+    }
+    return ss.str();
+}
@@ -0,0 +1,57 @@
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include "BatchOptimizer.h"
+#include <vector>
+#include <string>
+
+// Why a configuration failed the pre-filter. A row can fail several checks.
+enum PrefilterReason {
+    NonPhysical = 0,     // Non-finite value, or a non-positive diameter or primary f, or secondary R = 0
+    FocalMismatch,       // primaryR != 2 primaryF or secondaryR != 2 secondaryF
+    WrongConic,          // Secondary not a hyperbola (K >= -1); buildSystem would trace another surface
+    Obstructed,          // Secondary plus its hole margin covers the whole primary
+    NoRealFocus,         // Image never behind the primary vertex over the secondary scan
+    FocalLengthOffTarget,// |systemFocalLength| outside the range the scan can reach (grids' model)
+    PREFILTER_REASONS
+};
+
+// Rejections of a batch run, by reason
+struct PrefilterStats {
+    long long checked = 0;
+    long long rejected = 0;
+    long long failed[PREFILTER_REASONS] = {};  // Rows failing each check (rejected or only flagged)
+
+    // e.g. "Pre-filter: rejected 3 of 300 (non-physical 1, R/f mismatch 2); flagged (no real focus 63)"
+    std::string summary(PrefilterMode mode) const;
+};
+
+// First-order screen of configurations before any ray is traced. Checks
+// that the derived fields agree with the independent ones and that the
+// system buildSystem would make can possibly work, and drops the rows
+// that cannot. The checks run column by column over a structure-of-arrays
+// copy of the block, branch-free, so the compiler vectorises them.
+//
+// Standard mode rejects rows that are invalid or whose trace could only
+// score zero (NonPhysical, FocalMismatch, WrongConic, Obstructed). The
+// first-order optics checks (NoRealFocus, FocalLengthOffTarget) only flag
+// rows there, because the sensor scores defocused light too; Strict mode
+// rejects those as well. primaryK is not checked: buildSystem always
+// makes a paraboloid.
+class ConfigPrefilter {
+public:
+    // One bit per PrefilterReason for every config
+    static void classify(const std::vector<OpticalConfig>& configs,
+                         std::vector<unsigned char>& failures);
+
+    // Remove the rows mode rejects from configs and add them to stats.
+    // Returns the number removed.
+    static size_t apply(std::vector<OpticalConfig>& configs, PrefilterMode mode,
+                        PrefilterStats& stats);
+
+    // Reasons that reject a row in mode, as a bit mask
+    static unsigned char rejectMask(PrefilterMode mode);
+    static const char* reasonName(int reason);
+};
+
+#endif // PREFILTER_H
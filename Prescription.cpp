@@ -0,0 +1,172 @@
+#include "Prescription.h"
+#include <algorithm>
+
+void OpticalPrescription::add(const Mirror* surface, SurfaceRole role, int group,
+                              int firstBounce, int lastBounce) {
+    surfaces.push_back(PrescriptionSurface{surface, role, group, firstBounce, lastBounce});
+}
+
+bool OpticalPrescription::isSequential() const {
+    return std::none_of(surfaces.begin(), surfaces.end(),
+                        [](const PrescriptionSurface& s) { return s.group >= 0; });
+}
+
+OpticalPrescription OpticalPrescription::cassegrain(const ParabolicMirror& primary,
+                                                    const HyperbolicMirror& secondary,
+                                                    const CameraSensor& camera) {
+    OpticalPrescription prescription;
+    prescription.add(&secondary, SurfaceRole::Obstruction);
+    prescription.add(&primary, SurfaceRole::Mirror);
+    prescription.add(&secondary, SurfaceRole::Mirror);
+    prescription.add(&camera, SurfaceRole::Detector);
+    return prescription;
+}
+
+OpticalPrescription OpticalPrescription::nonSequential(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                                       const CameraSensor* camera) {
+    OpticalPrescription prescription;
+    for (const auto& mirror : mirrors) {
+        if (mirror->getType() == "hyperbolic") {
+            prescription.add(mirror.get(), SurfaceRole::Obstruction, 0, 0, 1);
+            prescription.add(mirror.get(), SurfaceRole::Mirror, 0, 1, 2);
+        } else {
+            prescription.add(mirror.get(), SurfaceRole::Mirror, 0, 0, 2);
+        }
+    }
+    if (camera) prescription.add(camera, SurfaceRole::Detector, 0);
+    return prescription;
+}
+
+OpticalPrescription OpticalPrescription::fromScene(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                                   const CameraSensor* camera, int maxBounces,
+                                                   TraceMode mode) {
+    const ParabolicMirror* primary;
+    const HyperbolicMirror* secondary;
+    if (mode == TraceMode::Sequential &&
+        TelescopeOptimizer::matchCassegrain(mirrors, camera, maxBounces, primary, secondary)) {
+        return cassegrain(*primary, *secondary, *camera);
+    }
+    return nonSequential(mirrors, camera);
+}
+
+PrescriptionTracer::PrescriptionTracer(const OpticalPrescription& prescription, int maxBounces)
+    : prescription(prescription), maxBounces(maxBounces) {
+    // The compiled path covers exactly the plain Cassegrain entry list
+    const auto& s = prescription.surfaces;
+    if (s.size() != 4 || !prescription.isSequential() || maxBounces < 3) return;
+    for (const auto& entry : s) {
+        if (entry.firstBounce != 0 || entry.lastBounce != std::numeric_limits<int>::max()) return;
+    }
+    if (s[0].role != SurfaceRole::Obstruction || s[1].role != SurfaceRole::Mirror ||
+        s[2].role != SurfaceRole::Mirror || s[3].role != SurfaceRole::Detector ||
+        s[0].surface != s[2].surface) return;
+
+    auto primary = dynamic_cast<const ParabolicMirror*>(s[1].surface);
+    auto secondary = dynamic_cast<const HyperbolicMirror*>(s[2].surface);
+    auto camera = dynamic_cast<const CameraSensor*>(s[3].surface);
+    if (!primary || !secondary || !camera) return;
+
+    compiled.emplace(Obstruction<HyperbolicMirror>{*secondary}, Reflection<ParabolicMirror>{*primary},
+                     Reflection<HyperbolicMirror>{*secondary}, Detector{*camera});
+}
+
+TraceOutcome PrescriptionTracer::trace(Ray& ray, sf::Vector2f& hitPoint) const {
+    if (compiled) return compiled->trace(ray, hitPoint);
+    return interpret(ray, hitPoint);
+}
+
+TraceOutcome PrescriptionTracer::interpret(Ray& ray, sf::Vector2f& hitPoint) const {
+    const std::vector<PrescriptionSurface>& surfaces = prescription.surfaces;
+    const size_t n = surfaces.size();
+    const float none = std::numeric_limits<float>::max();
+
+    float obstruction = none;  // Distance to a pending obstruction hit
+    int reflections = 0;
+    int tests = 0;
+
+    auto active = [&reflections](const PrescriptionSurface& entry) {
+        return reflections >= entry.firstBounce && reflections < entry.lastBounce;
+    };
+    auto block = [&ray]() {
+        ray.bounces = -1;
+        return TraceOutcome::Blocked;
+    };
+    auto detect = [&](const Intersection& hit) {
+        if (hit.hit && hit.distance < obstruction) {
+            ray.path.push_back(hit.point);
+            hitPoint = hit.point;
+            return TraceOutcome::Hit;
+        }
+        return obstruction < none ? block() : TraceOutcome::Missed;
+    };
+
+    size_t i = 0;
+    while (i < n) {
+        const PrescriptionSurface& entry = surfaces[i];
+
+        if (entry.group < 0) {
+            if (!active(entry)) {
+                i++;
+                continue;
+            }
+            if (entry.role == SurfaceRole::Obstruction) {
+                Intersection hit = entry.surface->intersect(ray);
+                if (hit.hit) obstruction = std::min(obstruction, hit.distance);
+                i++;
+                continue;
+            }
+
+            if (tests++ >= maxBounces) return TraceOutcome::Missed;
+            Intersection hit = entry.surface->intersect(ray);
+            if (entry.role == SurfaceRole::Detector) return detect(hit);
+
+            if (!hit.hit) {
+                // Travels on unreflected: only a later detector can catch it
+                for (size_t j = i + 1; j < n; j++) {
+                    if (surfaces[j].role == SurfaceRole::Detector && active(surfaces[j])) {
+                        return detect(surfaces[j].surface->intersect(ray));
+                    }
+                }
+                return obstruction < none ? block() : TraceOutcome::Missed;
+            }
+            if (obstruction < hit.distance) return block();
+
+            ray.reflect(hit.point, hit.normal);
+            reflections++;
+            obstruction = none;
+            i++;
+            continue;
+        }
+
+        // Non-sequential group: closest active member, until the ray misses them all
+        size_t end = i;
+        while (end < n && surfaces[end].group == entry.group) end++;
+
+        for (;;) {
+            if (tests++ >= maxBounces) return TraceOutcome::Missed;
+
+            Intersection closest;
+            const PrescriptionSurface* closestEntry = nullptr;
+            for (size_t k = i; k < end; k++) {
+                if (!active(surfaces[k])) continue;
+                Intersection hit = surfaces[k].surface->intersect(ray);
+                if (hit.hit && hit.distance < closest.distance) {
+                    closest = hit;
+                    closestEntry = &surfaces[k];
+                }
+            }
+            if (!closestEntry) break;
+            if (obstruction < closest.distance) return block();
+
+            if (closestEntry->role == SurfaceRole::Obstruction) return block();
+            if (closestEntry->role == SurfaceRole::Detector) return detect(closest);
+
+            ray.reflect(closest.point, closest.normal);
+            reflections++;
+            obstruction = none;
+        }
+        i = end;
+    }
+
+    return obstruction < none ? block() : TraceOutcome::Missed;
+}
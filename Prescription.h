@@ -0,0 +1,89 @@
+#ifndef PRESCRIPTION_H
+#define PRESCRIPTION_H
+
+#include "Optimizer.h"
+#include "SequentialTracer.h"
+#include <vector>
+#include <memory>
+#include <optional>
+#include <limits>
+
+enum class SurfaceRole {
+    Mirror,       // Reflects the ray
+    Obstruction,  // Stops a ray that meets it (e.g. the back of the secondary)
+    Detector      // Records the hit and ends the trace
+};
+
+// One entry of a prescription. The same mirror may appear more than once,
+// e.g. the secondary as an obstruction and later as a mirror.
+struct PrescriptionSurface {
+    const Mirror* surface;  // A mirror, or the CameraSensor of a Detector
+    SurfaceRole role;
+    int group;              // Consecutive entries sharing a group >= 0 form a non-sequential group
+    int firstBounce;        // Active while the ray has made firstBounce..lastBounce-1 reflections
+    int lastBounce;
+};
+
+// Ordered surface list describing how light moves through a system.
+//
+// Entries outside a group are sequential: the ray is tested against that
+// one surface. An Obstruction records where the ray meets it and blocks
+// the ray if it lies before the next mirror or detector. A Mirror the ray
+// misses lets it travel on unreflected to the next Detector.
+//
+// A group is searched like TelescopeOptimizer::traceToSensor: the closest
+// active member wins, reflections stay inside the group, and the ray
+// leaves the group once it misses every member.
+//
+// Every mirror or detector test (sequential entry or group search) uses
+// one of the trace's maxBounces.
+class OpticalPrescription {
+public:
+    std::vector<PrescriptionSurface> surfaces;
+
+    void add(const Mirror* surface, SurfaceRole role, int group = -1,
+             int firstBounce = 0, int lastBounce = std::numeric_limits<int>::max());
+
+    bool isSequential() const;
+
+    // Secondary (obstruction) -> primary -> secondary -> sensor
+    static OpticalPrescription cassegrain(const ParabolicMirror& primary,
+                                          const HyperbolicMirror& secondary,
+                                          const CameraSensor& camera);
+
+    // Every mirror and the camera in one group, with traceToSensor's rules
+    // as data: a hyperbolic mirror obstructs before the first reflection,
+    // and mirrors are only searched for the first two reflections
+    static OpticalPrescription nonSequential(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                             const CameraSensor* camera);
+
+    // The Cassegrain prescription when the scene is one that
+    // TelescopeOptimizer::matchCassegrain accepts and mode is Sequential,
+    // otherwise the full non-sequential search
+    static OpticalPrescription fromScene(const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                                         const CameraSensor* camera, int maxBounces,
+                                         TraceMode mode = TraceMode::Sequential);
+};
+
+// Traces rays through a prescription. The Cassegrain prescription runs on
+// the compiled CassegrainPath; anything else is interpreted entry by entry.
+// Safe to share between threads.
+class PrescriptionTracer {
+public:
+    PrescriptionTracer(const OpticalPrescription& prescription, int maxBounces);
+
+    // Same conventions as traceToSensor: hitPoint is set on a Hit and a
+    // blocked ray has bounces = -1
+    TraceOutcome trace(Ray& ray, sf::Vector2f& hitPoint) const;
+
+    bool isCompiled() const { return compiled.has_value(); }
+
+private:
+    OpticalPrescription prescription;
+    int maxBounces;
+    std::optional<CassegrainPath> compiled;
+
+    TraceOutcome interpret(Ray& ray, sf::Vector2f& hitPoint) const;
+};
+
+#endif // PRESCRIPTION_H
@@ -0,0 +1,131 @@
+#include "Progress.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+ProgressReporter::ProgressReporter(int totalConfigs, int numThreads, const ProgressSettings& settings)
+    : totalConfigs(totalConfigs), numThreads(std::max(numThreads, 1)), settings(settings),
+      bestScore(-std::numeric_limits<float>::infinity()),
+      busyNanos(new std::atomic<long long>[std::max(numThreads, 1)]),
+      lastBusy(std::max(numThreads, 1), 0) {
+    for (int t = 0; t < this->numThreads; t++) busyNanos[t].store(0);
+    startTime = Clock::now();
+    lastReport = startTime;
+}
+
+ProgressReporter::~ProgressReporter() {
+    if (running) stop();
+}
+
+void ProgressReporter::start() {
+    startTime = Clock::now();
+    lastReport = startTime;
+    running = true;
+    if (settings.intervalSeconds > 0.0) {
+        reporter = std::thread(&ProgressReporter::run, this);
+    }
+}
+
+void ProgressReporter::stop() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopSignal.notify_all();
+    if (reporter.joinable()) reporter.join();
+    running = false;
+    report(true);
+}
+
+void ProgressReporter::configDone(long long rays, float score) {
+    completed.fetch_add(1, std::memory_order_relaxed);
+    raysTraced.fetch_add(rays, std::memory_order_relaxed);
+
+    float best = bestScore.load(std::memory_order_relaxed);
+    while (score > best &&
+           !bestScore.compare_exchange_weak(best, score, std::memory_order_relaxed)) {
+    }
+}
+
+void ProgressReporter::addBusyTime(int thread, std::chrono::steady_clock::duration busy) {
+    busyNanos[thread].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count(),
+                                std::memory_order_relaxed);
+}
+
+void ProgressReporter::run() {
+    std::unique_lock<std::mutex> lock(stopMutex);
+    auto interval = std::chrono::duration<double>(settings.intervalSeconds);
+    while (!stopSignal.wait_for(lock, interval, [this] { return stopping; })) {
+        report(false);
+        if (reportCallback) reportCallback();
+    }
+}
+
+void ProgressReporter::report(bool final) {
+    Clock::time_point now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - startTime).count();
+    double sinceLast = std::chrono::duration<double>(now - lastReport).count();
+    if (final) sinceLast = elapsed;
+
+    int done = completed.load(std::memory_order_relaxed);
+    long long rays = raysTraced.load(std::memory_order_relaxed);
+    float best = bestScore.load(std::memory_order_relaxed);
+
+    double configsPerSec = elapsed > 0.0 ? done / elapsed : 0.0;
+    double raysPerSec = elapsed > 0.0 ? rays / elapsed : 0.0;
+    double eta = configsPerSec > 0.0 ? (totalConfigs - done) / configsPerSec : -1.0;
+
+    // Busy fraction per worker: since the last report, or the whole run at the end
+    std::vector<double> utilization(numThreads);
+    for (int t = 0; t < numThreads; t++) {
+        long long busy = busyNanos[t].load(std::memory_order_relaxed);
+        long long delta = final ? busy : busy - lastBusy[t];
+        lastBusy[t] = busy;
+        utilization[t] = sinceLast > 0.0 ? std::min(1.0, delta * 1e-9 / sinceLast) : 0.0;
+    }
+    lastReport = now;
+
+    std::ostringstream line;
+    line << "Progress: " << done << "/" << totalConfigs << " ("
+         << (totalConfigs > 0 ? 100 * done / totalConfigs : 100) << "%), "
+         << std::fixed << std::setprecision(1) << configsPerSec << " configs/s, "
+         << std::scientific << std::setprecision(2) << raysPerSec << " rays/s"
+         << std::fixed << std::setprecision(0);
+    if (!final && eta >= 0.0) line << ", ETA " << eta << " s";
+    if (final) line << ", " << std::setprecision(1) << elapsed << " s";
+    if (std::isfinite(best)) line << ", best " << std::setprecision(2) << best;
+    line << ", threads";
+    for (double u : utilization) line << " " << std::setprecision(0) << 100.0 * u << "%";
+    std::cout << line.str() << std::endl;
+
+    if (settings.statusFile.empty()) return;
+
+    std::string temp = settings.statusFile + ".tmp";
+    {
+        std::ofstream file(temp);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not write status file " << temp << std::endl;
+            return;
+        }
+        file << std::fixed << std::setprecision(3)
+             << "{\"state\": \"" << (final ? "done" : "running") << "\""
+             << ", \"completed\": " << done
+             << ", \"total\": " << totalConfigs
+             << ", \"elapsedSeconds\": " << elapsed
+             << ", \"configsPerSecond\": " << configsPerSec
+             << ", \"raysPerSecond\": " << raysPerSec
+             << ", \"etaSeconds\": " << (final ? 0.0 : eta)
+             << ", \"bestScore\": ";
+        if (std::isfinite(best)) file << best; else file << "null";
+        file << ", \"threadUtilization\": [";
+        for (int t = 0; t < numThreads; t++) file << (t ? ", " : "") << utilization[t];
+        file << "]}\n";
+    }
+    std::rename(temp.c_str(), settings.statusFile.c_str());
+}
@@ -0,0 +1,72 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ProgressSettings {
+    double intervalSeconds = 2.0;  // Between reports; <= 0 prints only the final line
+    std::string statusFile;        // JSON snapshot rewritten every report; empty = none
+    std::string resultsFile;       // Running top N rewritten every report (BatchOptimizer); empty = none
+};
+
+// Progress of a batch run, updated lock-free by the worker threads and
+// reported from a dedicated thread, so workers never touch iostreams.
+// Each report prints configs/s, rays/s, ETA, the best score so far and
+// every worker's busy fraction over the last interval, and optionally
+// replaces a status file (written to a temporary file and renamed, so a
+// poller never reads a partial one).
+class ProgressReporter {
+public:
+    ProgressReporter(int totalConfigs, int numThreads, const ProgressSettings& settings);
+    ~ProgressReporter();
+
+    // Run callback on the reporter thread after every periodic report
+    // (not the final one). Call before start().
+    void onReport(std::function<void()> callback) { reportCallback = std::move(callback); }
+
+    void start();
+    // Stop the reporter thread and print the final report
+    void stop();
+
+    // One configuration finished (any thread)
+    void configDone(long long rays, float score);
+    // Time worker thread spent evaluating (any thread, its own slot)
+    void addBusyTime(int thread, std::chrono::steady_clock::duration busy);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    int totalConfigs;
+    int numThreads;
+    ProgressSettings settings;
+
+    std::atomic<int> completed{0};
+    std::atomic<long long> raysTraced{0};
+    std::atomic<float> bestScore;
+    std::unique_ptr<std::atomic<long long>[]> busyNanos;
+
+    // Reporter thread state; the mutex only guards the stop signal
+    std::thread reporter;
+    std::mutex stopMutex;
+    std::condition_variable stopSignal;
+    bool stopping = false;
+    bool running = false;
+
+    Clock::time_point startTime;
+    Clock::time_point lastReport;
+    std::vector<long long> lastBusy;
+    std::function<void()> reportCallback;
+
+    void run();
+    void report(bool final);
+};
+
+#endif // PROGRESS_H
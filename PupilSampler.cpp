@@ -0,0 +1,216 @@
+#include "PupilSampler.h"
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <algorithm>
+
+double PupilSampler::radicalInverse(unsigned index, unsigned base) {
+    double inverseBase = 1.0 / base;
+    double factor = inverseBase;
+    double result = 0.0;
+    while (index > 0) {
+        result += (index % base) * factor;
+        index /= base;
+        factor *= inverseBase;
+    }
+    return result;
+}
+
+unsigned PupilSampler::sobolDim2(unsigned index) {
+    // Second Sobol dimension: primitive polynomial x + 1, m_1 = 1, so the
+    // direction numbers satisfy v_k = v_{k-1} ^ (v_{k-1} >> 1)
+    unsigned result = 0;
+    unsigned direction = 1u << 31;
+    for (; index != 0; index >>= 1) {
+        if (index & 1u) result ^= direction;
+        direction ^= direction >> 1;
+    }
+    return result;
+}
+
+void PupilSampler::unitSquare(const SamplerSettings& settings, int numRays,
+                              std::vector<double>& u, std::vector<double>& v) {
+    u.resize(numRays);
+    v.resize(numRays);
+
+    std::mt19937 rng(settings.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double inv32 = 1.0 / 4294967296.0;
+
+    switch (settings.type) {
+        case SamplerType::StratifiedJitter: {
+            // Latin hypercube: jittered strata in u, a shuffled set of strata in v
+            std::vector<int> permutation(numRays);
+            std::iota(permutation.begin(), permutation.end(), 0);
+            std::shuffle(permutation.begin(), permutation.end(), rng);
+            for (int i = 0; i < numRays; i++) {
+                u[i] = (i + uniform(rng)) / numRays;
+                v[i] = (permutation[i] + uniform(rng)) / numRays;
+            }
+            break;
+        }
+        case SamplerType::Halton: {
+            // Cranley-Patterson rotation keeps the sequence reproducible per seed
+            double shiftU = uniform(rng), shiftV = uniform(rng);
+            for (int i = 0; i < numRays; i++) {
+                u[i] = std::fmod(radicalInverse(i + 1, 2) + shiftU, 1.0);
+                v[i] = std::fmod(radicalInverse(i + 1, 3) + shiftV, 1.0);
+            }
+            break;
+        }
+        case SamplerType::Sobol: {
+            // Random digital shift (XOR scramble) derived from the seed
+            unsigned scrambleU = rng(), scrambleV = rng();
+            for (int i = 0; i < numRays; i++) {
+                unsigned index = static_cast<unsigned>(i);
+                unsigned bitsU = 0;
+                for (int bit = 0; bit < 32; bit++) {
+                    if (index & (1u << bit)) bitsU |= 1u << (31 - bit);
+                }
+                u[i] = (bitsU ^ scrambleU) * inv32;
+                v[i] = (sobolDim2(index) ^ scrambleV) * inv32;
+            }
+            break;
+        }
+        case SamplerType::Uniform:
+        case SamplerType::AreaWeighted:
+        default: {
+            const double goldenRatioConjugate = (std::sqrt(5.0) - 1.0) / 2.0;
+            for (int i = 0; i < numRays; i++) {
+                u[i] = (i + 0.5) / numRays;
+                v[i] = std::fmod(i * goldenRatioConjugate, 1.0);
+            }
+            break;
+        }
+    }
+}
+
+std::vector<float> PupilSampler::sampleFan(const SamplerSettings& settings, int numRays,
+                                           float yMin, float yMax, float rMin) {
+    std::vector<float> heights;
+    if (numRays <= 0) return heights;
+    heights.resize(numRays);
+
+    if (settings.type == SamplerType::Uniform) {
+        // Exactly the original evenly spaced fan
+        for (int i = 0; i < numRays; i++) {
+            heights[i] = yMin + i * (yMax - yMin) / (numRays - 1);
+        }
+        return heights;
+    }
+
+    std::vector<double> u, v;
+    unitSquare(settings, numRays, u, v);
+
+    if (settings.type == SamplerType::AreaWeighted) {
+        double rMax = std::max(std::abs(yMin), std::abs(yMax));
+        double r2Min = static_cast<double>(rMin) * rMin;
+        double r2Span = rMax * rMax - r2Min;
+        for (int i = 0; i < numRays; i++) {
+            double s = 2.0 * u[i] - 1.0;
+            double r = std::sqrt(r2Min + std::abs(s) * r2Span);
+            heights[i] = static_cast<float>(s < 0.0 ? -r : r);
+        }
+        return heights;
+    }
+
+    for (int i = 0; i < numRays; i++) {
+        heights[i] = static_cast<float>(yMin + u[i] * (yMax - yMin));
+    }
+    return heights;
+}
+
+PupilSamples PupilSampler::sampleAnnulus(const SamplerSettings& settings, int numRays,
+                                         float rMin, float rMax) {
+    if (settings.type == SamplerType::Uniform || settings.type == SamplerType::AreaWeighted) {
+        return Tracer3D::sampleAnnulus(numRays, rMin, rMax);
+    }
+
+    PupilSamples pupil;
+    if (numRays <= 0) return pupil;
+    pupil.y.resize(numRays);
+    pupil.z.resize(numRays);
+
+    std::vector<double> u, v;
+    unitSquare(settings, numRays, u, v);
+
+    double r2Min = static_cast<double>(rMin) * rMin;
+    double r2Span = static_cast<double>(rMax) * rMax - r2Min;
+    for (int i = 0; i < numRays; i++) {
+        double r = std::sqrt(r2Min + u[i] * r2Span);
+        double theta = 2.0 * M_PI * v[i];
+        pupil.y[i] = static_cast<float>(r * std::cos(theta));
+        pupil.z[i] = static_cast<float>(r * std::sin(theta));
+    }
+    return pupil;
+}
+
+std::vector<int> PupilSampler::interleavedOrder(int n) {
+    std::vector<int> order;
+    if (n <= 0) return order;
+    order.reserve(n);
+
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+
+    for (int i = 0; i < (1 << bits); i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+        }
+        if (reversed < n) order.push_back(reversed);
+    }
+    return order;
+}
+
+void PupilSampler::interleave(std::vector<float>& heights) {
+    std::vector<int> order = interleavedOrder(static_cast<int>(heights.size()));
+    std::vector<float> reordered(heights.size());
+    for (size_t i = 0; i < order.size(); i++) reordered[i] = heights[order[i]];
+    heights.swap(reordered);
+}
+
+void PupilSampler::interleave(std::vector<float>& heights, std::vector<int>& weights) {
+    std::vector<int> order = interleavedOrder(static_cast<int>(heights.size()));
+    std::vector<float> reorderedHeights(heights.size());
+    std::vector<int> reorderedWeights(weights.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        reorderedHeights[i] = heights[order[i]];
+        if (!weights.empty()) reorderedWeights[i] = weights[order[i]];
+    }
+    heights.swap(reorderedHeights);
+    weights.swap(reorderedWeights);
+}
+
+void PupilSampler::interleave(PupilSamples& pupil) {
+    std::vector<int> order = interleavedOrder(static_cast<int>(pupil.size()));
+    PupilSamples reordered;
+    reordered.y.resize(pupil.size());
+    reordered.z.resize(pupil.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        reordered.y[i] = pupil.y[order[i]];
+        reordered.z[i] = pupil.z[order[i]];
+    }
+    std::swap(pupil, reordered);
+}
+
+bool PupilSampler::parseType(const std::string& name, SamplerType& type) {
+    if (name == "uniform") type = SamplerType::Uniform;
+    else if (name == "stratified") type = SamplerType::StratifiedJitter;
+    else if (name == "halton") type = SamplerType::Halton;
+    else if (name == "sobol") type = SamplerType::Sobol;
+    else if (name == "area") type = SamplerType::AreaWeighted;
+    else return false;
+    return true;
+}
+
+const char* PupilSampler::typeName(SamplerType type) {
+    switch (type) {
+        case SamplerType::StratifiedJitter: return "stratified";
+        case SamplerType::Halton: return "halton";
+        case SamplerType::Sobol: return "sobol";
+        case SamplerType::AreaWeighted: return "area";
+        case SamplerType::Uniform:
+        default: return "uniform";
+    }
+}
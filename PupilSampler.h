@@ -0,0 +1,53 @@
+#ifndef PUPIL_SAMPLER_H
+#define PUPIL_SAMPLER_H
+
+#include "Tracer3D.h"
+#include <vector>
+#include <string>
+
+enum class SamplerType {
+    Uniform,           // Evenly spaced fan / golden-angle spiral (the original behavior)
+    StratifiedJitter,  // One random sample per equal-width stratum
+    Halton,            // Halton low-discrepancy sequence (bases 2, 3)
+    Sobol,             // Sobol low-discrepancy sequence (first two dimensions)
+    AreaWeighted       // 2-D fan with density proportional to |h|, i.e. to annulus area
+};
+
+struct SamplerSettings {
+    SamplerType type = SamplerType::Uniform;
+    unsigned seed = 1;  // Jitter / random shift seed; same seed gives the same samples
+};
+
+// Pupil sampling strategies shared by the 2-D fan tracers and the 3-D tracer.
+// All randomized variants are reproducible for a given seed.
+class PupilSampler {
+public:
+    // Launch heights for a 2-D meridional fan. AreaWeighted samples
+    // |h| in [rMin, max(|yMin|, |yMax|)] so that each ray stands for an
+    // equal area of the rotationally symmetric pupil.
+    static std::vector<float> sampleFan(const SamplerSettings& settings, int numRays,
+                                        float yMin, float yMax, float rMin = 0.0f);
+
+    // Area-uniform samples over the annulus rMin..rMax for the 3-D tracer
+    static PupilSamples sampleAnnulus(const SamplerSettings& settings, int numRays,
+                                      float rMin, float rMax);
+
+    // Bit-reversed visiting order of 0..n-1: every prefix is spread across the
+    // whole pupil, so partially traced evaluations give representative bounds
+    static std::vector<int> interleavedOrder(int n);
+    static void interleave(std::vector<float>& heights);
+    static void interleave(std::vector<float>& heights, std::vector<int>& weights);
+    static void interleave(PupilSamples& pupil);
+
+    static bool parseType(const std::string& name, SamplerType& type);
+    static const char* typeName(SamplerType type);
+
+private:
+    // Points in the unit square [0,1)^2; only the first coordinate is used by 2-D fans
+    static void unitSquare(const SamplerSettings& settings, int numRays,
+                           std::vector<double>& u, std::vector<double>& v);
+    static double radicalInverse(unsigned index, unsigned base);
+    static unsigned sobolDim2(unsigned index);
+};
+
+#endif // PUPIL_SAMPLER_H
@@ -6,8 +6,9 @@ Intersection::Intersection()
     : hit(false), distance(std::numeric_limits<float>::max()), mirrorPtr(nullptr) {}
 
 // Ray implementation
-Ray::Ray(sf::Vector2f orig, sf::Vector2f dir, sf::Color col)
+Ray::Ray(sf::Vector2f orig, sf::Vector2f dir, sf::Color col, RayPathBuffer* pathBuffer)
     : origin(orig), direction(dir), color(col), bounces(0) {
+    path.attach(pathBuffer);
     path.push_back(origin);
     normalizeDirection();
 }
@@ -17,15 +17,55 @@ struct Intersection {
     Intersection();
 };
 
+// Flat storage for the paths of many rays: each ray's polyline is a
+// contiguous run of points in one shared vector. Cleared and reused every
+// frame, so once its capacity has grown tracing allocates nothing.
+class RayPathBuffer {
+public:
+    std::vector<sf::Vector2f> points;
+
+    void clear() { points.clear(); }
+    void reserve(size_t n) { points.reserve(n); }
+};
+
+// A ray's path as a view (offset, length) into a RayPathBuffer. Rays must be
+// traced one after another so each appends to the buffer's tail. Without a
+// buffer nothing is recorded; the optimizers only need the sensor hit point.
+class RayPath {
+public:
+    RayPath() : buffer(nullptr), offset(0), length(0) {}
+
+    void attach(RayPathBuffer* buf) {
+        buffer = buf;
+        offset = buf ? buf->points.size() : 0;
+        length = 0;
+    }
+
+    void push_back(const sf::Vector2f& point) {
+        if (!buffer) return;
+        buffer->points.push_back(point);
+        length++;
+    }
+
+    size_t size() const { return length; }
+    const sf::Vector2f& operator[](size_t i) const { return buffer->points[offset + i]; }
+
+private:
+    RayPathBuffer* buffer;
+    size_t offset;
+    size_t length;
+};
+
 class Ray {
 public:
     sf::Vector2f origin;
     sf::Vector2f direction;
-    std::vector<sf::Vector2f> path;
+    RayPath path;
     sf::Color color;
     int bounces;
 
-    Ray(sf::Vector2f orig, sf::Vector2f dir, sf::Color col = sf::Color::Red);
+    Ray(sf::Vector2f orig, sf::Vector2f dir, sf::Color col = sf::Color::Red,
+        RayPathBuffer* pathBuffer = nullptr);
     
     void normalizeDirection();
     sf::Vector2f pointAt(float t) const;
@@ -0,0 +1,208 @@
+#include "ResultCache.h"
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdio>
+
+ResultCache::ResultCache(const std::string& fname) : filename(fname) {}
+
+namespace {
+const char* const CACHE_HEADER = "Key,CameraHits,HitPercentage,RMSSpotSize,BestSecondaryX,BestSecondaryY,"
+                                 "Score,RMSError,ScoreError,EE50,EE80";
+}
+
+int ResultCache::load() {
+    if (filename.empty()) return 0;
+
+    std::ifstream file(filename);
+    int loaded = 0;
+    bool exists = file.is_open();
+    bool ownHeader = false;
+    int dataLines = 0;
+
+    if (exists) {
+        std::string line;
+        bool firstLine = true;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (firstLine) {
+                firstLine = false;
+                ownHeader = line == CACHE_HEADER;
+                if (line.empty() || ownHeader) continue;
+            }
+            if (line.empty()) continue;
+            dataLines++;
+
+            // Key,CameraHits,HitPercentage,RMSSpotSize,BestSecondaryX,BestSecondaryY,
+            // Score,RMSError,ScoreError,EE50,EE80
+            std::stringstream ss(line);
+            std::string token;
+            std::vector<std::string> tokens;
+            while (std::getline(ss, token, ',')) tokens.push_back(token);
+            if (tokens.size() < 11) continue;  // Rows from an older cache version
+
+            try {
+                std::uint64_t key = std::stoull(tokens[0], nullptr, 16);
+                Entry entry;
+                entry.cameraHits = std::stoi(tokens[1]);
+                entry.hitPercentage = std::stof(tokens[2]);
+                entry.rmsSpotSize = std::stof(tokens[3]);
+                entry.bestSecondaryX = std::stof(tokens[4]);
+                entry.bestSecondaryY = std::stof(tokens[5]);
+                entry.score = std::stof(tokens[6]);
+                entry.rmsError = std::stof(tokens[7]);
+                entry.scoreError = std::stof(tokens[8]);
+                entry.ee50 = std::stof(tokens[9]);
+                entry.ee80 = std::stof(tokens[10]);
+                entries[key] = entry;
+                loaded++;
+            } catch (...) {
+                // Skip truncated rows from an interrupted run
+            }
+        }
+        file.close();
+    }
+
+    // Never truncate: a non-empty file without a single cache row is not
+    // ours (or from an incompatible version), so leave it alone and keep
+    // this run's cache in memory
+    bool empty = !exists || (!ownHeader && dataLines == 0);
+    if (exists && loaded == 0 && !empty && !(ownHeader && dataLines == 0)) {
+        std::cerr << "Warning: " << filename << " is not a result cache; not writing to it "
+                  << "(results are cached for this run only)" << std::endl;
+        return 0;
+    }
+
+    appendFile.open(filename, empty ? std::ios::out : std::ios::app);
+    if (!appendFile.is_open()) {
+        std::cerr << "Warning: could not open result cache " << filename << " for writing" << std::endl;
+    } else if (empty) {
+        appendFile << CACHE_HEADER << "\n";
+        appendFile.flush();
+    }
+
+    return loaded;
+}
+
+bool ResultCache::lookup(std::uint64_t key, BatchResult& result) const {
+    auto it = entries.find(key);
+    if (it == entries.end()) return false;
+
+    const Entry& entry = it->second;
+    result.cameraHits = entry.cameraHits;
+    result.hitPercentage = entry.hitPercentage;
+    result.rmsSpotSize = entry.rmsSpotSize;
+    result.bestSecondaryX = entry.bestSecondaryX;
+    result.bestSecondaryY = entry.bestSecondaryY;
+    result.score = entry.score;
+    result.rmsError = entry.rmsError;
+    result.scoreError = entry.scoreError;
+    result.ee50 = entry.ee50;
+    result.ee80 = entry.ee80;
+    result.raysTraced = 0;
+    return true;
+}
+
+void ResultCache::store(std::uint64_t key, const BatchResult& result) {
+    Entry entry;
+    entry.cameraHits = result.cameraHits;
+    entry.hitPercentage = result.hitPercentage;
+    entry.rmsSpotSize = result.rmsSpotSize;
+    entry.bestSecondaryX = result.bestSecondaryX;
+    entry.bestSecondaryY = result.bestSecondaryY;
+    entry.score = result.score;
+    entry.rmsError = result.rmsError;
+    entry.scoreError = result.scoreError;
+    entry.ee50 = result.ee50;
+    entry.ee80 = result.ee80;
+    entries[key] = entry;
+
+    if (appendFile.is_open()) {
+        // Full precision so cached rows rank exactly like fresh evaluations
+        appendFile << std::hex << key << std::dec << ","
+                   << entry.cameraHits << ","
+                   << std::setprecision(9) << entry.hitPercentage << ","
+                   << entry.rmsSpotSize << ","
+                   << entry.bestSecondaryX << ","
+                   << entry.bestSecondaryY << ","
+                   << entry.score << ","
+                   << entry.rmsError << ","
+                   << entry.scoreError << ","
+                   << entry.ee50 << ","
+                   << entry.ee80 << "\n";
+        appendFile.flush();
+    }
+}
+
+std::uint64_t ResultCache::makeKey(
+    const OpticalConfig& config,
+    const CameraSensor* camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    const TraceOptions& options
+) {
+    // Floats at round-trip precision and integers exactly, so distinct
+    // settings never share a canonical string
+    std::string canonical;
+    auto append = [&canonical](float value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g|", value == 0.0f ? 0.0 : static_cast<double>(value));
+        canonical += buffer;
+    };
+    auto appendInt = [&canonical](long long value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%lld|", value);
+        canonical += buffer;
+    };
+    auto appendUnsigned = [&canonical](unsigned long long value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%llu|", value);
+        canonical += buffer;
+    };
+
+    appendInt(CACHE_VERSION);
+    append(config.primaryDiameter);
+    append(config.secondaryDiameter);
+    append(config.primaryF);
+    append(config.secondaryR);
+    append(config.secondaryK);
+    append(config.mirrorSeparation);
+
+    appendInt(numRays);
+    append(rayStartX);
+    append(rayYMin);
+    append(rayYMax);
+    appendInt(maxBounces);
+
+    if (camera) {
+        append(camera->center.x);
+        append(camera->center.y);
+        append(camera->width);
+        append(camera->angle);
+    }
+
+    appendInt(options.trace3D ? 1 : 0);
+    appendInt(options.exploitSymmetry ? 1 : 0);
+    appendInt(static_cast<int>(options.objective));
+    appendInt(static_cast<int>(options.sampler.type));
+    appendUnsigned(options.sampler.seed);
+    appendInt(static_cast<int>(options.fields.scoring));
+    for (float angle : options.fields.anglesArcmin) append(angle);
+    canonical += "w|";
+    for (float weight : options.fields.weights) append(weight);
+    append(options.targetScoreError);
+    // warmStart is left out: a warm-started row looks up the cold key, as a
+    // stored full scan is at least as good as its local search. Warm results
+    // themselves are never stored (see evaluateBlock).
+
+    // FNV-1a, 64-bit
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : canonical) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
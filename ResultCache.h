@@ -0,0 +1,65 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "BatchOptimizer.h"
+#include <string>
+#include <unordered_map>
+#include <fstream>
+#include <cstdint>
+
+// Persistent store of evaluated configurations, keyed by a canonical hash of
+// everything that influences evaluateConfig's outcome. Also deduplicates
+// identical rows within a single batch.
+class ResultCache {
+public:
+    // Empty filename keeps the cache in memory only
+    explicit ResultCache(const std::string& filename = "");
+
+    // Read previously cached rows; returns the number loaded
+    int load();
+
+    bool lookup(std::uint64_t key, BatchResult& result) const;
+
+    // Remember a result and append it to the cache file (if any)
+    void store(std::uint64_t key, const BatchResult& result);
+
+    size_t size() const { return entries.size(); }
+
+    // Canonical key: the OpticalConfig fields evaluateConfig actually uses
+    // (primaryDiameter, secondaryDiameter, primaryF, secondaryR, secondaryK,
+    // mirrorSeparation) plus camera placement and all trace settings that change results.
+    // Floats are formatted at round-trip precision, integers exactly.
+    static std::uint64_t makeKey(
+        const OpticalConfig& config,
+        const CameraSensor* camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        const TraceOptions& options
+    );
+
+private:
+    struct Entry {
+        int cameraHits;
+        float hitPercentage;
+        float rmsSpotSize;
+        float bestSecondaryX;
+        float bestSecondaryY;
+        float score;
+        float rmsError;
+        float scoreError;
+        float ee50;
+        float ee80;
+    };
+
+    std::string filename;
+    std::unordered_map<std::uint64_t, Entry> entries;
+    std::ofstream appendFile;
+
+    // Bump when the tracer changes in a way that invalidates cached scores
+    static const int CACHE_VERSION = 4;
+};
+
+#endif // RESULT_CACHE_H
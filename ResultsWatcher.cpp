@@ -0,0 +1,197 @@
+#include "ResultsWatcher.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+static std::uint64_t fileIdentity(const std::string& filename) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat info;
+    if (stat(filename.c_str(), &info) == 0) return static_cast<std::uint64_t>(info.st_ino);
+#endif
+    return 0;
+}
+
+ResultsWatcher::ResultsWatcher(const std::string& fname)
+    : filename(fname), running(false), reloadRequested(false), updateReady(false),
+      parsedBytes(0), fileId(0) {}
+
+ResultsWatcher::~ResultsWatcher() {
+    stop();
+}
+
+std::vector<OpticalConfig> ResultsWatcher::loadInitial() {
+    ResultsUpdate update;
+    parseChanges(update, true);
+    if (!update.rows.empty()) {
+        std::cout << "Loaded " << update.rows.size() << " optimized configurations from "
+                  << filename << std::endl;
+    }
+    return update.rows;
+}
+
+void ResultsWatcher::start() {
+    if (running) return;
+    running = true;
+    worker = std::thread(&ResultsWatcher::run, this);
+}
+
+void ResultsWatcher::stop() {
+    running = false;
+    if (worker.joinable()) worker.join();
+}
+
+void ResultsWatcher::requestReload() {
+    reloadRequested = true;
+}
+
+bool ResultsWatcher::takeUpdate(ResultsUpdate& update) {
+    if (!updateReady) return false;
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    update = std::move(pending);
+    pending = ResultsUpdate();
+    updateReady = false;
+    return true;
+}
+
+void ResultsWatcher::publish(ResultsUpdate& update) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (update.replaced) {
+        pending.replaced = true;
+        pending.rows = std::move(update.rows);
+    } else {
+        pending.rows.insert(pending.rows.end(), update.rows.begin(), update.rows.end());
+    }
+    // A rewrite caught before its first row is held back until rows arrive,
+    // so the GUI never sees an empty list
+    if (!pending.rows.empty()) updateReady = true;
+}
+
+bool ResultsWatcher::parseChanges(ResultsUpdate& update, bool forceFull) {
+    update.replaced = false;
+    update.rows.clear();
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    file.seekg(0, std::ios::end);
+    std::uint64_t size = static_cast<std::uint64_t>(file.tellg());
+    std::uint64_t id = fileIdentity(filename);
+
+    bool rewritten = forceFull || id != fileId || size < parsedBytes;
+    if (!rewritten && !parsedTail.empty()) {
+        // batch_optimize renames a new file over it (a new inode), but other
+        // writers rewrite in place; if the bytes we stopped at are no longer
+        // there, this is a new file rather than an append
+        std::string tail(parsedTail.size(), '\0');
+        file.seekg(static_cast<std::streamoff>(parsedBytes - parsedTail.size()));
+        file.read(&tail[0], static_cast<std::streamsize>(tail.size()));
+        rewritten = !file || tail != parsedTail;
+        file.clear();
+    }
+    if (!rewritten && size == parsedBytes) return false;
+
+    std::uint64_t start = rewritten ? 0 : parsedBytes;
+    std::string chunk(static_cast<size_t>(size - start), '\0');
+    file.seekg(static_cast<std::streamoff>(start));
+    file.read(&chunk[0], static_cast<std::streamsize>(chunk.size()));
+    chunk.resize(static_cast<size_t>(file.gcount()));
+    file.clear();
+
+    // Only complete lines; a row still being written is picked up next time
+    size_t lastNewline = chunk.rfind('\n');
+    size_t complete = (lastNewline == std::string::npos) ? 0 : lastNewline + 1;
+
+    size_t lineStart = 0;
+    while (lineStart < complete) {
+        size_t lineEnd = chunk.find('\n', lineStart);
+        std::string line = chunk.substr(lineStart, lineEnd - lineStart);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        bool isHeader = (start == 0 && lineStart == 0);
+        OpticalConfig config;
+        if (!isHeader && BatchOptimizer::parseResultRow(line, config)) {
+            update.rows.push_back(config);
+        }
+        lineStart = lineEnd + 1;
+    }
+
+    parsedBytes = start + complete;
+    fileId = id;
+
+    size_t tailLength = static_cast<size_t>(std::min<std::uint64_t>(parsedBytes, TAIL_BYTES));
+    parsedTail.assign(tailLength, '\0');
+    if (tailLength > 0) {
+        file.seekg(static_cast<std::streamoff>(parsedBytes - tailLength));
+        file.read(&parsedTail[0], static_cast<std::streamsize>(tailLength));
+    }
+
+    update.replaced = rewritten;
+    return rewritten || !update.rows.empty();
+}
+
+void ResultsWatcher::run() {
+    int inotifyFd = -1;
+    std::string watchedName = std::filesystem::path(filename).filename().string();
+
+#ifdef __linux__
+    // Watch the directory so files that are replaced or created are seen too
+    std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+    if (directory.empty()) directory = std::filesystem::current_path();
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0 &&
+        inotify_add_watch(inotifyFd, directory.c_str(),
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+
+    while (running) {
+        bool changed = false;
+
+#ifdef __linux__
+        if (inotifyFd >= 0) {
+            // Wake at least every poll interval so stop() and reloads are honoured
+            pollfd descriptor = {inotifyFd, POLLIN, 0};
+            if (poll(&descriptor, 1, POLL_INTERVAL_MS) > 0) {
+                alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+                ssize_t length;
+                while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                    for (char* p = buffer; p < buffer + length; ) {
+                        const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                        if (event->len > 0 && watchedName == event->name) changed = true;
+                        p += sizeof(inotify_event) + event->len;
+                    }
+                }
+            }
+        }
+#endif
+        if (inotifyFd < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+            changed = true;  // Polling: let parseChanges decide
+        }
+
+        bool forceFull = reloadRequested.exchange(false);
+        if (!changed && !forceFull) continue;
+
+        ResultsUpdate update;
+        if (parseChanges(update, forceFull)) {
+            publish(update);
+        }
+    }
+
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
@@ -0,0 +1,68 @@
+#ifndef RESULTS_WATCHER_H
+#define RESULTS_WATCHER_H
+
+#include "BatchOptimizer.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Rows picked up by a ResultsWatcher since the last takeUpdate()
+struct ResultsUpdate {
+    bool replaced = false;            // File was rewritten: rows replace the old list
+    std::vector<OpticalConfig> rows;  // Otherwise rows were appended to the file
+};
+
+// Follows a results CSV (e.g. optimization_results.csv while batch_optimize
+// runs) and parses only the lines added since the last look, on a
+// background thread. Uses inotify on Linux; elsewhere it polls the file.
+class ResultsWatcher {
+public:
+    explicit ResultsWatcher(const std::string& filename);
+    ~ResultsWatcher();
+
+    // Parse the whole file on the calling thread (for the first frame) and
+    // remember where parsing stopped. Call before start().
+    std::vector<OpticalConfig> loadInitial();
+
+    void start();
+    void stop();
+
+    // Re-parse the whole file on the background thread
+    void requestReload();
+
+    bool hasUpdate() const { return updateReady; }
+
+    // Move out pending rows; false if nothing new arrived
+    bool takeUpdate(ResultsUpdate& update);
+
+private:
+    std::string filename;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<bool> reloadRequested;
+    std::atomic<bool> updateReady;
+
+    std::mutex pendingMutex;
+    ResultsUpdate pending;
+
+    // Parse state; owned by the worker thread once started
+    std::uint64_t parsedBytes;  // Offset just past the last complete line parsed
+    std::string parsedTail;     // Bytes ending at parsedBytes, to spot in-place rewrites
+    std::uint64_t fileId;       // Inode of the parsed file (0 where unavailable)
+
+    void run();
+
+    // Parse complete lines added since the last call. Returns false if
+    // nothing changed; sets update.replaced when the file was rewritten.
+    bool parseChanges(ResultsUpdate& update, bool forceFull);
+
+    void publish(ResultsUpdate& update);
+
+    static const int POLL_INTERVAL_MS = 250;
+    static const size_t TAIL_BYTES = 64;
+};
+
+#endif // RESULTS_WATCHER_H
@@ -0,0 +1,112 @@
+#ifndef SEQUENTIAL_TRACER_H
+#define SEQUENTIAL_TRACER_H
+
+#include "Mirror.h"
+#include "Camera.h"
+#include "Optimizer.h"
+#include <tuple>
+#include <limits>
+#include <cstddef>
+#include <type_traits>
+
+// Stages of a sequential path, in the order a ray meets their surfaces.
+// Each stage intersects its one surface once per ray, through a qualified
+// (non-virtual) call on the concrete surface type.
+enum class StageKind { Obstruction, Reflection, Detector };
+
+// A surface the incoming ray must clear: the ray is blocked if it meets it
+// before the next stage's surface, or meets it and misses that surface
+template<typename Surface>
+struct Obstruction {
+    static constexpr StageKind kind = StageKind::Obstruction;
+    const Surface& surface;
+    Intersection intersect(const Ray& ray) const { return surface.Surface::intersect(ray); }
+};
+
+// A mirror the ray reflects off. A ray that misses it travels on
+// unreflected, and only the path's detector can still catch it.
+template<typename Surface>
+struct Reflection {
+    static constexpr StageKind kind = StageKind::Reflection;
+    const Surface& surface;
+    Intersection intersect(const Ray& ray) const { return surface.Surface::intersect(ray); }
+};
+
+// The sensor that ends the path
+struct Detector {
+    static constexpr StageKind kind = StageKind::Detector;
+    const CameraSensor& sensor;
+    Intersection intersect(const Ray& ray) const { return sensor.CameraSensor::intersect(ray); }
+};
+
+// Tracer for a scene whose surface order is fixed at compile time. Where
+// TelescopeOptimizer::traceToSensor searches every mirror and the camera for
+// the closest hit on each bounce, a sequential path tries only the next
+// surface, so a ray costs one intersection per stage and no virtual calls.
+// The last stage must be the Detector.
+template<typename... Stages>
+class SequentialPath {
+public:
+    static constexpr size_t numStages = sizeof...(Stages);
+
+    explicit SequentialPath(const Stages&... stages) : stages(stages...) {}
+
+    // Outcome and ray bookkeeping (path, bounces, -1 when blocked) as
+    // traceToSensor reports them; hitPoint is set when the outcome is Hit
+    TraceOutcome trace(Ray& ray, sf::Vector2f& hitPoint) const {
+        return step<0>(ray, hitPoint, std::numeric_limits<float>::max());
+    }
+
+private:
+    std::tuple<Stages...> stages;
+
+    // obstruction is the distance to a pending Obstruction hit, if any
+    template<size_t I>
+    TraceOutcome step(Ray& ray, sf::Vector2f& hitPoint, float obstruction) const {
+        const auto& stage = std::get<I>(stages);
+        typedef std::decay_t<decltype(stage)> Stage;
+        Intersection hit = stage.intersect(ray);
+
+        static_assert((Stage::kind == StageKind::Detector) == (I + 1 == numStages),
+                      "a sequential path has one Detector, its last stage");
+
+        if constexpr (Stage::kind == StageKind::Detector) {
+            return detect(ray, hitPoint, hit, obstruction);
+        } else if constexpr (Stage::kind == StageKind::Obstruction) {
+            return step<I + 1>(ray, hitPoint, hit.hit ? hit.distance : obstruction);
+        } else {
+            if (!hit.hit) {
+                const Detector& detector = std::get<numStages - 1>(stages);
+                return detect(ray, hitPoint, detector.intersect(ray), obstruction);
+            }
+            if (obstruction < hit.distance) return block(ray);
+            ray.reflect(hit.point, hit.normal);
+            return step<I + 1>(ray, hitPoint, std::numeric_limits<float>::max());
+        }
+    }
+
+    static TraceOutcome detect(Ray& ray, sf::Vector2f& hitPoint, const Intersection& hit, float obstruction) {
+        if (hit.hit && hit.distance < obstruction) {
+            ray.path.push_back(hit.point);
+            hitPoint = hit.point;
+            return TraceOutcome::Hit;
+        }
+        if (obstruction < std::numeric_limits<float>::max()) return block(ray);
+        return TraceOutcome::Missed;
+    }
+
+    static TraceOutcome block(Ray& ray) {
+        ray.bounces = -1;
+        return TraceOutcome::Blocked;
+    }
+};
+
+// The production topology: light passes the secondary (its back obstructs
+// the aperture), reflects off the primary, then the secondary, and lands on
+// the sensor through the primary's hole
+typedef SequentialPath<Obstruction<HyperbolicMirror>,
+                       Reflection<ParabolicMirror>,
+                       Reflection<HyperbolicMirror>,
+                       Detector> CassegrainPath;
+
+#endif // SEQUENTIAL_TRACER_H
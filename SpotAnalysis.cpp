@@ -0,0 +1,117 @@
+#include "SpotAnalysis.h"
+#include <cmath>
+#include <algorithm>
+
+int SpotMetrics::psfAt(int du, int dv) const {
+    if (std::abs(du) > psfRadius || std::abs(dv) > psfRadius || psf.empty()) return 0;
+    int side = 2 * psfRadius + 1;
+    return psf[(dv + psfRadius) * side + (du + psfRadius)];
+}
+
+SpotMetrics SpotAnalyzer::analyze(const float* u, const float* v, size_t count,
+                                  float pixelSize, SpotScratch& scratch, int psfRadius) {
+    SpotMetrics metrics;
+    metrics.pixelSize = pixelSize;
+    metrics.psfRadius = psfRadius;
+    metrics.psf.assign((2 * psfRadius + 1) * (2 * psfRadius + 1), 0);
+    metrics.hits = static_cast<int>(count);
+    if (count == 0 || pixelSize <= 0.0f) return metrics;
+
+    // Single pass: pixel key and first/second moments per hit. Pixel
+    // indices are biased into unsigned range so keys sort by (u, v).
+    scratch.keys.resize(count);
+    const float invPixel = 1.0f / pixelSize;
+    const std::int64_t bias = std::int64_t(1) << 31;
+    double sumU = 0.0, sumV = 0.0, sumSq = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        float hu = u[i], hv = v[i];
+        std::int64_t pu = static_cast<std::int64_t>(std::floor(hu * invPixel)) + bias;
+        std::int64_t pv = static_cast<std::int64_t>(std::floor(hv * invPixel)) + bias;
+        scratch.keys[i] = (static_cast<std::uint64_t>(pu) << 32) | static_cast<std::uint32_t>(pv);
+        sumU += hu;
+        sumV += hv;
+        sumSq += static_cast<double>(hu) * hu + static_cast<double>(hv) * hv;
+    }
+
+    double n = static_cast<double>(count);
+    double cu = sumU / n, cv = sumV / n;
+    metrics.centroidU = static_cast<float>(cu);
+    metrics.centroidV = static_cast<float>(cv);
+    metrics.rmsRadius = static_cast<float>(std::sqrt(std::max(0.0, sumSq / n - cu * cu - cv * cv)));
+
+    // Run-length encode the sorted keys into occupied pixels
+    std::sort(scratch.keys.begin(), scratch.keys.end());
+    std::int64_t centroidPu = static_cast<std::int64_t>(std::floor(cu / pixelSize));
+    std::int64_t centroidPv = static_cast<std::int64_t>(std::floor(cv / pixelSize));
+    int side = 2 * psfRadius + 1;
+    int peak = 0;
+    scratch.rings.clear();
+
+    for (size_t start = 0; start < count; ) {
+        size_t end = start + 1;
+        while (end < count && scratch.keys[end] == scratch.keys[start]) end++;
+        int hitsInPixel = static_cast<int>(end - start);
+
+        std::int64_t pu = static_cast<std::int64_t>(scratch.keys[start] >> 32) - bias;
+        std::int64_t pv = static_cast<std::int64_t>(scratch.keys[start] & 0xffffffffu) - bias;
+
+        double du = (pu + 0.5) * pixelSize - cu;
+        double dv = (pv + 0.5) * pixelSize - cv;
+        scratch.rings.emplace_back(static_cast<float>(std::sqrt(du * du + dv * dv)), hitsInPixel);
+
+        std::int64_t offsetU = pu - centroidPu, offsetV = pv - centroidPv;
+        if (std::abs(offsetU) <= psfRadius && std::abs(offsetV) <= psfRadius) {
+            metrics.psf[(offsetV + psfRadius) * side + (offsetU + psfRadius)] += hitsInPixel;
+        }
+
+        peak = std::max(peak, hitsInPixel);
+        metrics.occupiedPixels++;
+        start = end;
+    }
+    metrics.peakFraction = static_cast<float>(peak / n);
+
+    // Encircled energy: grow a circle about the centroid pixel by pixel.
+    // A spot inside one pixel still reports half a pixel.
+    std::sort(scratch.rings.begin(), scratch.rings.end());
+    float halfPixel = 0.5f * pixelSize;
+    int enclosed = 0;
+    bool have50 = false;
+    for (const auto& ring : scratch.rings) {
+        enclosed += ring.second;
+        if (!have50 && enclosed >= 0.5 * n) {
+            metrics.ee50 = std::max(ring.first, halfPixel);
+            have50 = true;
+        }
+        if (enclosed >= 0.8 * n) {
+            metrics.ee80 = std::max(ring.first, halfPixel);
+            break;
+        }
+    }
+
+    return metrics;
+}
+
+SpotMetrics SpotAnalyzer::analyze(const CameraSensor& camera, SpotScratch& scratch, int psfRadius) {
+    size_t count = camera.hitPoints.size();
+    scratch.u.resize(count);
+    scratch.v.assign(count, 0.0f);
+
+    float sx = std::cos(camera.angle), sy = std::sin(camera.angle);
+    for (size_t i = 0; i < count; i++) {
+        scratch.u[i] = (camera.hitPoints[i].x - camera.center.x) * sx +
+                       (camera.hitPoints[i].y - camera.center.y) * sy;
+    }
+    return analyze(scratch.u.data(), scratch.v.data(), count, pixelSizeMm(camera), scratch, psfRadius);
+}
+
+SpotMetrics SpotAnalyzer::analyze(const SpotDiagram& spot, const CameraSensor& camera,
+                                  SpotScratch& scratch, int psfRadius) {
+    size_t count = spot.points.size();
+    scratch.u.resize(count);
+    scratch.v.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        scratch.u[i] = spot.points[i].x;
+        scratch.v[i] = spot.points[i].y;
+    }
+    return analyze(scratch.u.data(), scratch.v.data(), count, pixelSizeMm(camera), scratch, psfRadius);
+}
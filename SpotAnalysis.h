@@ -0,0 +1,59 @@
+#ifndef SPOT_ANALYSIS_H
+#define SPOT_ANALYSIS_H
+
+#include "Camera.h"
+#include "Tracer3D.h"
+#include <vector>
+#include <cstdint>
+
+// Image quality of a spot as the sensor sees it: hits binned into pixels
+struct SpotMetrics {
+    int hits = 0;
+    float pixelSize = 0.0f;     // mm
+    float centroidU = 0.0f;     // Centroid offset from the sensor centre (mm)
+    float centroidV = 0.0f;
+    float rmsRadius = 0.0f;     // About the centroid (mm)
+    float ee50 = 0.0f;          // Radius about the centroid enclosing 50% of hits (mm)
+    float ee80 = 0.0f;          // ... and 80%; both resolved to whole pixels
+    float peakFraction = 0.0f;  // Share of hits in the brightest pixel
+    int occupiedPixels = 0;
+
+    // Approximate PSF: hit counts in a (2*psfRadius+1)^2 pixel window
+    // centred on the centroid pixel, row-major with v increasing by row
+    int psfRadius = 0;
+    std::vector<int> psf;
+
+    int psfAt(int du, int dv) const;
+};
+
+// Reusable buffers so repeated analyses inside an optimizer do not reallocate
+struct SpotScratch {
+    std::vector<float> u, v;
+    std::vector<std::uint64_t> keys;
+    std::vector<std::pair<float, int>> rings;  // (pixel distance from centroid, hits)
+};
+
+// Bins sensor hits into the camera's pixel grid (PIXEL_SIZE_MICRONS) and
+// derives encircled energy, PSF and centroid. The hits are visited once:
+// a branch-free loop over structure-of-arrays coordinates computes pixel
+// keys and moments together, then only occupied pixels are processed, so
+// the cost is O(n log n) regardless of sensor size.
+class SpotAnalyzer {
+public:
+    // u, v: hit positions on the sensor plane relative to its centre (mm)
+    static SpotMetrics analyze(const float* u, const float* v, size_t count,
+                               float pixelSize, SpotScratch& scratch, int psfRadius = 8);
+
+    // 2-D meridional hits on a CameraSensor (projected onto the sensor line, v = 0)
+    static SpotMetrics analyze(const CameraSensor& camera, SpotScratch& scratch, int psfRadius = 8);
+
+    // 3-D spot diagram from Tracer3D, already in sensor coordinates
+    static SpotMetrics analyze(const SpotDiagram& spot, const CameraSensor& camera,
+                               SpotScratch& scratch, int psfRadius = 8);
+
+    static float pixelSizeMm(const CameraSensor& camera) {
+        return camera.PIXEL_SIZE_MICRONS / 1000.0f;
+    }
+};
+
+#endif // SPOT_ANALYSIS_H
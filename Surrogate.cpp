@@ -0,0 +1,131 @@
+#include "Surrogate.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+// In-place Cholesky factorisation of the n x n row-major matrix A (lower
+// triangle); false if A is not positive definite
+bool cholesky(std::vector<double>& A, size_t n) {
+    for (size_t j = 0; j < n; j++) {
+        double diagonal = A[j * n + j];
+        for (size_t k = 0; k < j; k++) diagonal -= A[j * n + k] * A[j * n + k];
+        if (diagonal <= 0.0) return false;
+        double Ljj = std::sqrt(diagonal);
+        A[j * n + j] = Ljj;
+        for (size_t i = j + 1; i < n; i++) {
+            double sum = A[i * n + j];
+            for (size_t k = 0; k < j; k++) sum -= A[i * n + k] * A[j * n + k];
+            A[i * n + j] = sum / Ljj;
+        }
+    }
+    return true;
+}
+
+// Solve L L^T x = b in place, L from cholesky
+void choleskySolve(const std::vector<double>& L, size_t n, double* b) {
+    for (size_t i = 0; i < n; i++) {
+        double sum = b[i];
+        for (size_t k = 0; k < i; k++) sum -= L[i * n + k] * b[k];
+        b[i] = sum / L[i * n + i];
+    }
+    for (size_t i = n; i-- > 0;) {
+        double sum = b[i];
+        for (size_t k = i + 1; k < n; k++) sum -= L[k * n + i] * b[k];
+        b[i] = sum / L[i * n + i];
+    }
+}
+
+}  // namespace
+
+double RBFSurrogate::kernel(const Point& a, const Point& b) const {
+    double distSq = 0.0;
+    for (int d = 0; d < DIMS; d++) {
+        double diff = a[d] - b[d];
+        distSq += diff * diff;
+    }
+    return std::exp(-distSq * invWidthSq);
+}
+
+bool RBFSurrogate::fit(const std::vector<Point>& points, const std::vector<std::vector<double>>& outputs) {
+    centres = points;
+    size_t n = centres.size();
+    size_t numOutputs = outputs.size();
+    if (n == 0) return false;
+
+    // Width: twice the mean nearest-neighbour distance of the centres
+    double meanNearest = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double nearest = std::numeric_limits<double>::max();
+        for (size_t j = 0; j < n; j++) {
+            if (j == i) continue;
+            double distSq = 0.0;
+            for (int d = 0; d < DIMS; d++) {
+                double diff = centres[i][d] - centres[j][d];
+                distSq += diff * diff;
+            }
+            nearest = std::min(nearest, distSq);
+        }
+        if (n > 1) meanNearest += std::sqrt(nearest);
+    }
+    meanNearest /= n;
+    double width = meanNearest > 0.0 ? 2.0 * meanNearest : 1.0;
+    invWidthSq = 1.0 / (width * width);
+
+    // Kernel matrix, with the ridge raised until it factorises
+    std::vector<double> L;
+    bool factored = false;
+    for (double ridge = 1e-8; ridge <= 1e-2 && !factored; ridge *= 100.0) {
+        L.assign(n * n, 0.0);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j <= i; j++) L[i * n + j] = kernel(centres[i], centres[j]);
+            L[i * n + i] += ridge;
+        }
+        factored = cholesky(L, n);
+    }
+    if (!factored) return false;
+
+    // Diagonal of the inverse, for the leave-one-out errors: with y = L^-1 e_i
+    // (zero above row i), (A^-1)_ii = |y|^2
+    std::vector<double> inverseDiagonal(n);
+    std::vector<double> y(n);
+    for (size_t i = 0; i < n; i++) {
+        y[i] = 1.0 / L[i * n + i];
+        double sumSq = y[i] * y[i];
+        for (size_t k = i + 1; k < n; k++) {
+            double sum = 0.0;
+            for (size_t m = i; m < k; m++) sum -= L[k * n + m] * y[m];
+            y[k] = sum / L[k * n + k];
+            sumSq += y[k] * y[k];
+        }
+        inverseDiagonal[i] = sumSq;
+    }
+
+    means.assign(numOutputs, 0.0);
+    weights.assign(numOutputs, std::vector<double>(n));
+    looRMS.assign(numOutputs, 0.0);
+    for (size_t k = 0; k < numOutputs; k++) {
+        for (double value : outputs[k]) means[k] += value;
+        means[k] /= n;
+        for (size_t i = 0; i < n; i++) weights[k][i] = outputs[k][i] - means[k];
+        choleskySolve(L, n, weights[k].data());
+
+        double sumSq = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double error = weights[k][i] / inverseDiagonal[i];
+            sumSq += error * error;
+        }
+        looRMS[k] = std::sqrt(sumSq / n);
+    }
+    return true;
+}
+
+void RBFSurrogate::predict(const Point& x, double* out) const {
+    size_t numOutputs = means.size();
+    for (size_t k = 0; k < numOutputs; k++) out[k] = means[k];
+    for (size_t i = 0; i < centres.size(); i++) {
+        double phi = kernel(x, centres[i]);
+        for (size_t k = 0; k < numOutputs; k++) out[k] += weights[k][i] * phi;
+    }
+}
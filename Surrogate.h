@@ -0,0 +1,40 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include <array>
+#include <vector>
+#include <cstddef>
+
+// Gaussian radial-basis-function interpolant over points in the unit cube,
+// for screening configurations without tracing them. Several outputs share
+// the centres and one factorisation. The width follows the mean spacing of
+// the centres, a small ridge keeps near-duplicate centres solvable, and the
+// leave-one-out error of every output comes from the inverse kernel matrix
+// (Rippa's formula), so no refits are needed to judge the fit.
+class RBFSurrogate {
+public:
+    static const int DIMS = 6;
+    typedef std::array<float, DIMS> Point;
+
+    // outputs[k][i] is output k at centres[i]; false if the kernel matrix
+    // is not positive definite
+    bool fit(const std::vector<Point>& centres, const std::vector<std::vector<double>>& outputs);
+
+    // All outputs at x (out has one entry per output)
+    void predict(const Point& x, double* out) const;
+
+    // Root-mean-square leave-one-out error of output k
+    double looError(int output) const { return looRMS[output]; }
+    size_t size() const { return centres.size(); }
+
+private:
+    std::vector<Point> centres;
+    double invWidthSq = 1.0;
+    std::vector<double> means;                 // Per output, subtracted before fitting
+    std::vector<std::vector<double>> weights;  // Per output, one per centre
+    std::vector<double> looRMS;
+
+    double kernel(const Point& a, const Point& b) const;
+};
+
+#endif // SURROGATE_H
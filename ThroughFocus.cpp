@@ -0,0 +1,193 @@
+#include "ThroughFocus.h"
+#include "Optimizer.h"
+#include "Parallel.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+// Bundle projected onto the sensor frame. For a plane moved by s along the
+// normal, a ray meets it at t = (base + s) * invDenom, at sensor coordinate
+// u = along + t * alongDir. Rays parallel to the sensor get invDenom = 0
+// (t = 0), which the hit test rejects without a branch.
+struct ProjectedBundle {
+    std::vector<float> base, invDenom, along, alongDir;
+    float halfWidth = 0.0f;
+};
+
+void project(const FinalRayBundle& bundle, const CameraSensor& camera, ProjectedBundle& projected) {
+    const float sx = std::cos(camera.angle), sy = std::sin(camera.angle);
+    const float nx = sy, ny = -sx;
+    const size_t n = bundle.size();
+
+    projected.base.resize(n);
+    projected.invDenom.resize(n);
+    projected.along.resize(n);
+    projected.alongDir.resize(n);
+    projected.halfWidth = camera.width / 2.0f;
+
+    for (size_t i = 0; i < n; i++) {
+        float rx = bundle.ox[i] - camera.center.x;
+        float ry = bundle.oy[i] - camera.center.y;
+        float denom = bundle.dx[i] * nx + bundle.dy[i] * ny;
+        projected.base[i] = -(rx * nx + ry * ny);
+        projected.invDenom[i] = std::abs(denom) > EPSILON ? 1.0f / denom : 0.0f;
+        projected.along[i] = rx * sx + ry * sy;
+        projected.alongDir[i] = bundle.dx[i] * sx + bundle.dy[i] * sy;
+    }
+}
+
+FocusPoint evaluatePlane(const ProjectedBundle& projected, float offset) {
+    // Independent partial sums per lane so the loop vectorizes without
+    // reassociating floating-point additions
+    const int LANES = 8;
+    double count[LANES] = {}, sum[LANES] = {}, sumSq[LANES] = {};
+
+    const size_t n = projected.base.size();
+    const float* base = projected.base.data();
+    const float* invDenom = projected.invDenom.data();
+    const float* along = projected.along.data();
+    const float* alongDir = projected.alongDir.data();
+    const float halfWidth = projected.halfWidth;
+
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (int lane = 0; lane < LANES; lane++) {
+            float t = (base[i + lane] + offset) * invDenom[i + lane];
+            float u = along[i + lane] + t * alongDir[i + lane];
+            double hit = (t > EPSILON && std::abs(u) <= halfWidth) ? 1.0 : 0.0;
+            count[lane] += hit;
+            sum[lane] += hit * u;
+            sumSq[lane] += hit * u * u;
+        }
+    }
+    for (; i < n; i++) {
+        float t = (base[i] + offset) * invDenom[i];
+        float u = along[i] + t * alongDir[i];
+        double hit = (t > EPSILON && std::abs(u) <= halfWidth) ? 1.0 : 0.0;
+        count[0] += hit;
+        sum[0] += hit * u;
+        sumSq[0] += hit * u * u;
+    }
+
+    double hits = 0.0, total = 0.0, totalSq = 0.0;
+    for (int lane = 0; lane < LANES; lane++) {
+        hits += count[lane];
+        total += sum[lane];
+        totalSq += sumSq[lane];
+    }
+
+    FocusPoint point;
+    point.offset = offset;
+    point.hits = static_cast<int>(hits);
+    point.rmsSpotSize = 0.0f;
+    if (point.hits >= 2) {
+        double mean = total / hits;
+        point.rmsSpotSize = static_cast<float>(std::sqrt(std::max(0.0, totalSq / hits - mean * mean)));
+    }
+    return point;
+}
+
+bool better(const FocusPoint& a, const FocusPoint& b) {
+    return a.hits > b.hits || (a.hits == b.hits && a.rmsSpotSize < b.rmsSpotSize);
+}
+
+} // namespace
+
+void FinalRayBundle::clear() {
+    ox.clear(); oy.clear();
+    dx.clear(); dy.clear();
+    totalRays = 0;
+    blockedRays = 0;
+}
+
+void ThroughFocus::captureBundle(
+    const std::vector<std::unique_ptr<Mirror>>& mirrors,
+    const std::vector<float>& heights,
+    float rayStartX,
+    int maxBounces,
+    FinalRayBundle& bundle
+) {
+    bundle.clear();
+    bundle.ox.reserve(heights.size());
+    bundle.oy.reserve(heights.size());
+    bundle.dx.reserve(heights.size());
+    bundle.dy.reserve(heights.size());
+
+    for (float h : heights) {
+        Ray ray(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
+        sf::Vector2f hitPoint;
+        TraceOutcome outcome = TelescopeOptimizer::traceToSensor(ray, mirrors, nullptr,
+                                                                 maxBounces, hitPoint);
+        bundle.totalRays++;
+
+        if (outcome == TraceOutcome::Blocked) {
+            bundle.blockedRays++;
+            continue;
+        }
+        // Without a sensor a ray ends either by leaving the mirrors (its
+        // final segment) or by running out of bounces (it never reaches one)
+        if (ray.bounces >= maxBounces) continue;
+
+        bundle.ox.push_back(ray.origin.x);
+        bundle.oy.push_back(ray.origin.y);
+        bundle.dx.push_back(ray.direction.x);
+        bundle.dy.push_back(ray.direction.y);
+    }
+}
+
+FocusPoint ThroughFocus::evaluate(const FinalRayBundle& bundle, const CameraSensor& camera, float offset) {
+    ProjectedBundle projected;
+    project(bundle, camera, projected);
+    return evaluatePlane(projected, offset);
+}
+
+FocusCurve ThroughFocus::sweep(
+    const FinalRayBundle& bundle,
+    const CameraSensor& camera,
+    float minOffset,
+    float maxOffset,
+    int steps
+) {
+    FocusCurve curve;
+    if (steps <= 0) return curve;
+
+    ProjectedBundle projected;
+    project(bundle, camera, projected);
+
+    float step = steps > 1 ? (maxOffset - minOffset) / (steps - 1) : 0.0f;
+    curve.points.resize(steps);
+    parallelFor(static_cast<size_t>(steps), [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+            curve.points[s] = evaluatePlane(projected, minOffset + step * s);
+        }
+    }, 32);
+
+    curve.bestIndex = 0;
+    for (int s = 1; s < steps; s++) {
+        if (better(curve.points[s], curve.points[curve.bestIndex])) curve.bestIndex = s;
+    }
+    FocusPoint best = curve.points[curve.bestIndex];
+
+    // With a fixed set of hits every u is linear in the offset, so RMS^2 is
+    // exactly quadratic: the parabola through the best sample and its
+    // neighbours locates the minimum between samples
+    int b = curve.bestIndex;
+    if (b > 0 && b + 1 < steps &&
+        curve.points[b - 1].hits == best.hits && curve.points[b + 1].hits == best.hits) {
+        double r0 = std::pow(curve.points[b - 1].rmsSpotSize, 2.0);
+        double r1 = std::pow(best.rmsSpotSize, 2.0);
+        double r2 = std::pow(curve.points[b + 1].rmsSpotSize, 2.0);
+        double curvature = r0 - 2.0 * r1 + r2;
+        if (curvature > 0.0) {
+            float vertex = best.offset + static_cast<float>(0.5 * step * (r0 - r2) / curvature);
+            FocusPoint refined = evaluatePlane(projected, vertex);
+            if (!better(best, refined)) best = refined;
+        }
+    }
+
+    curve.bestOffset = best.offset;
+    curve.bestRMS = best.rmsSpotSize;
+    curve.bestHits = best.hits;
+    return curve;
+}
@@ -0,0 +1,70 @@
+#ifndef THROUGH_FOCUS_H
+#define THROUGH_FOCUS_H
+
+#include "Mirror.h"
+#include "Camera.h"
+#include <vector>
+#include <memory>
+
+// Final segments of a traced fan, after the last mirror, as structure of
+// arrays. Everything the sensor does to the rays happens on these lines.
+struct FinalRayBundle {
+    std::vector<float> ox, oy;
+    std::vector<float> dx, dy;
+    int totalRays = 0;    // Rays launched
+    int blockedRays = 0;  // Stopped by the secondary on the way in
+
+    size_t size() const { return ox.size(); }
+    void clear();
+};
+
+struct FocusPoint {
+    float offset;       // Sensor displacement along its normal (mm)
+    int hits;
+    float rmsSpotSize;  // About the centroid on the sensor (mm)
+};
+
+struct FocusCurve {
+    std::vector<FocusPoint> points;
+    int bestIndex = -1;       // Most hits, then smallest RMS (as the optimizers rank)
+    float bestOffset = 0.0f;  // Refined between samples where the hit count is flat
+    float bestRMS = 0.0f;
+    int bestHits = 0;
+};
+
+// Through-focus analysis from a single trace. The fan is traced to the last
+// mirror once; every candidate sensor plane is then an analytic line/plane
+// intersection of the stored bundle, so hundreds of focus positions cost
+// about as much as one extra trace.
+//
+// The sensor keeps its angle and width and slides along its normal
+// (sin(angle), -cos(angle)), i.e. along +x for the vertical sensor. Swept
+// positions must lie beyond the last mirror: a sensor that would cut an
+// earlier ray segment is not modelled.
+class ThroughFocus {
+public:
+    // Trace launch heights through the mirrors with the same rules as
+    // TelescopeOptimizer::traceToSensor, minus the sensor
+    static void captureBundle(
+        const std::vector<std::unique_ptr<Mirror>>& mirrors,
+        const std::vector<float>& heights,
+        float rayStartX,
+        int maxBounces,
+        FinalRayBundle& bundle
+    );
+
+    // Hits and RMS on `steps` sensor planes evenly spaced over
+    // [minOffset, maxOffset] relative to the camera's current position
+    static FocusCurve sweep(
+        const FinalRayBundle& bundle,
+        const CameraSensor& camera,
+        float minOffset,
+        float maxOffset,
+        int steps
+    );
+
+    // Hits and RMS with the sensor moved by `offset` along its normal
+    static FocusPoint evaluate(const FinalRayBundle& bundle, const CameraSensor& camera, float offset);
+};
+
+#endif // THROUGH_FOCUS_H
@@ -0,0 +1,248 @@
+#include "ToleranceAnalysis.h"
+#include "Optimizer.h"
+#include "Parallel.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+
+namespace {
+
+// A ray's first segment, which no secondary perturbation can change except
+// by blocking it: where it meets the primary and the sensor, and the ray
+// reflected off the primary
+struct FirstLeg {
+    Ray incoming;
+    Ray afterPrimary;
+    float primaryDistance;  // Intersection::distance, float max when missed
+    float cameraDistance;
+    sf::Vector2f cameraPoint;
+};
+
+struct SecondaryNominal {
+    float centerX, centerY;
+    float a;
+    float yMin, yMax;
+    float secondaryK;
+};
+
+void applyPerturbation(HyperbolicMirror& secondary, const SecondaryNominal& nominal,
+                       const Perturbation& p) {
+    secondary.centerX = nominal.centerX + p.spacingMm;
+    secondary.centerY = nominal.centerY + p.decenterMm;
+    secondary.yMin = nominal.yMin + p.decenterMm;
+    secondary.yMax = nominal.yMax + p.decenterMm;
+    secondary.tilt = p.tiltArcmin * static_cast<float>(M_PI) / (180.0f * 60.0f);
+    secondary.b = nominal.a * std::sqrt(std::abs(nominal.secondaryK + p.conic + 1.0f));
+}
+
+// Same decisions as TelescopeOptimizer::traceToSensor's first bounce, with
+// the primary and sensor taken from the shared legs
+void traceInstance(const std::vector<FirstLeg>& legs,
+                   const std::vector<std::unique_ptr<Mirror>>& mirrors,
+                   const HyperbolicMirror& secondary,
+                   const CameraSensor& camera,
+                   int maxBounces,
+                   std::vector<sf::Vector2f>& hits) {
+    hits.clear();
+    for (const auto& leg : legs) {
+        Intersection blocker = secondary.intersect(leg.incoming);
+        bool secondaryFirst = blocker.hit && blocker.distance < leg.primaryDistance;
+        float closest = secondaryFirst ? blocker.distance : leg.primaryDistance;
+
+        if (leg.cameraDistance < closest) {
+            hits.push_back(leg.cameraPoint);
+        } else if (secondaryFirst || !(leg.primaryDistance < std::numeric_limits<float>::max())) {
+            continue;  // Blocked by the secondary, or missed everything
+        } else {
+            Ray ray = leg.afterPrimary;
+            sf::Vector2f hitPoint;
+            if (TelescopeOptimizer::traceToSensor(ray, mirrors, &camera, maxBounces, hitPoint, 1)
+                == TraceOutcome::Hit) {
+                hits.push_back(hitPoint);
+            }
+        }
+    }
+}
+
+DistributionSummary summarize(std::vector<float> values) {
+    DistributionSummary summary;
+    if (values.empty()) return summary;
+
+    double sum = 0.0, sumSq = 0.0;
+    for (float v : values) {
+        sum += v;
+        sumSq += static_cast<double>(v) * v;
+    }
+    double n = static_cast<double>(values.size());
+    summary.mean = static_cast<float>(sum / n);
+    summary.stdDev = static_cast<float>(std::sqrt(std::max(0.0, sumSq / n - (sum / n) * (sum / n))));
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](double q) {
+        return values[static_cast<size_t>(std::lround(q * (values.size() - 1)))];
+    };
+    summary.p5 = percentile(0.05);
+    summary.median = percentile(0.5);
+    summary.p95 = percentile(0.95);
+    return summary;
+}
+
+} // namespace
+
+ToleranceReport ToleranceAnalyzer::analyze(
+    const BatchResult& result,
+    const CameraSensor& camera,
+    int numRays,
+    float rayStartX,
+    float rayYMin,
+    float rayYMax,
+    int maxBounces,
+    const TraceOptions& options,
+    const ToleranceSpec& spec
+) {
+    ToleranceReport report;
+
+    std::vector<std::unique_ptr<Mirror>> mirrors;
+    BatchOptimizer::buildSystem(result.config, mirrors);
+    const Mirror* primary = mirrors[0].get();
+    HyperbolicMirror* secondary = dynamic_cast<HyperbolicMirror*>(mirrors[1].get());
+    const float holeRadius = dynamic_cast<const ParabolicMirror*>(primary)->holeRadius;
+
+    SecondaryNominal nominal;
+    nominal.centerX = result.bestSecondaryX;
+    nominal.centerY = result.bestSecondaryY;
+    nominal.a = secondary->a;
+    nominal.yMin = secondary->yMin;
+    nominal.yMax = secondary->yMax;
+    nominal.secondaryK = result.config.secondaryK;
+
+    // The fan evaluateConfig ranked, with every ray's first leg traced once
+    std::vector<float> heights = PupilSampler::sampleFan(options.sampler, numRays, rayYMin, rayYMax,
+                                                         holeRadius);
+    const int launched = static_cast<int>(heights.size());
+    std::vector<FirstLeg> legs;
+    legs.reserve(heights.size());
+    for (float h : heights) {
+        Ray incoming(sf::Vector2f(rayStartX, h), sf::Vector2f(1.0f, 0.0f));
+        Intersection primaryHit = primary->intersect(incoming);
+        Intersection cameraHit = camera.intersect(incoming);
+
+        Ray afterPrimary = incoming;
+        if (primaryHit.hit) afterPrimary.reflect(primaryHit.point, primaryHit.normal);
+        legs.push_back({incoming, afterPrimary, primaryHit.distance, cameraHit.distance,
+                        cameraHit.point});
+    }
+
+    auto percentOf = [launched](int hits) {
+        return launched > 0 ? (100.0f * hits) / launched : 0.0f;
+    };
+
+    // Nominal instance and one-at-a-time sensitivities
+    std::vector<sf::Vector2f> hits;
+    auto evaluate = [&](const Perturbation& p, int& hitCount, float& rms) {
+        applyPerturbation(*secondary, nominal, p);
+        traceInstance(legs, mirrors, *secondary, camera, maxBounces, hits);
+        hitCount = static_cast<int>(hits.size());
+        rms = CameraSensor::computeRMSSpotSize(hits);
+    };
+
+    evaluate(Perturbation(), report.nominalHits, report.nominalRMS);
+    report.nominalHitPercentage = percentOf(report.nominalHits);
+
+    struct Parameter {
+        const char* name;
+        float sigma;
+        float Perturbation::* field;
+    };
+    const Parameter parameters[] = {
+        {"Tilt (arcmin)", spec.tiltArcmin, &Perturbation::tiltArcmin},
+        {"Decenter (mm)", spec.decenterMm, &Perturbation::decenterMm},
+        {"Spacing (mm)", spec.spacingMm, &Perturbation::spacingMm},
+        {"Conic", spec.conic, &Perturbation::conic}
+    };
+
+    for (const auto& parameter : parameters) {
+        if (parameter.sigma <= 0.0f) continue;
+        ParameterSensitivity sensitivity;
+        sensitivity.name = parameter.name;
+        sensitivity.sigma = parameter.sigma;
+
+        Perturbation p;
+        int hitsMinus, hitsPlus;
+        p.*parameter.field = -parameter.sigma;
+        evaluate(p, hitsMinus, sensitivity.rmsMinus);
+        p.*parameter.field = parameter.sigma;
+        evaluate(p, hitsPlus, sensitivity.rmsPlus);
+
+        sensitivity.hitPercentageMinus = percentOf(hitsMinus);
+        sensitivity.hitPercentagePlus = percentOf(hitsPlus);
+        sensitivity.rmsSlope = (sensitivity.rmsPlus - sensitivity.rmsMinus) / (2.0f * parameter.sigma);
+        report.sensitivities.push_back(sensitivity);
+    }
+
+    // Monte Carlo instances; each thread perturbs its own copy of the system
+    const int trials = std::max(0, spec.trials);
+    report.samples.resize(trials);
+    parallelFor(static_cast<size_t>(trials), [&](size_t begin, size_t end) {
+        std::vector<std::unique_ptr<Mirror>> threadMirrors;
+        BatchOptimizer::buildSystem(result.config, threadMirrors);
+        HyperbolicMirror* threadSecondary = dynamic_cast<HyperbolicMirror*>(threadMirrors[1].get());
+        std::vector<sf::Vector2f> threadHits;
+
+        std::mt19937_64 rng;
+        std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+        for (size_t trial = begin; trial < end; trial++) {
+            rng.seed((static_cast<std::uint64_t>(spec.seed) << 32) ^
+                     (trial * 0x9E3779B97F4A7C15ull));
+            gaussian.reset();
+
+            Perturbation p;
+            p.tiltArcmin = spec.tiltArcmin * gaussian(rng);
+            p.decenterMm = spec.decenterMm * gaussian(rng);
+            p.spacingMm = spec.spacingMm * gaussian(rng);
+            p.conic = spec.conic * gaussian(rng);
+
+            applyPerturbation(*threadSecondary, nominal, p);
+            traceInstance(legs, threadMirrors, *threadSecondary, camera, maxBounces, threadHits);
+
+            ToleranceSample& sample = report.samples[trial];
+            sample.perturbation = p;
+            sample.hits = static_cast<int>(threadHits.size());
+            sample.hitPercentage = percentOf(sample.hits);
+            sample.rmsSpotSize = CameraSensor::computeRMSSpotSize(threadHits);
+        }
+    }, 16);
+
+    std::vector<float> rmsValues, hitValues;
+    for (const auto& sample : report.samples) {
+        rmsValues.push_back(sample.rmsSpotSize);
+        hitValues.push_back(sample.hitPercentage);
+    }
+    report.rms = summarize(rmsValues);
+    report.hitPercentage = summarize(hitValues);
+    return report;
+}
+
+void ToleranceAnalyzer::saveSamplesToCSV(const ToleranceReport& report, const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create tolerance file: " << filename << std::endl;
+        return;
+    }
+
+    file << "Trial,TiltArcmin,DecenterMm,SpacingMm,Conic,CameraHits,HitPercentage,RMSSpotSize" << std::endl;
+    file << std::fixed << std::setprecision(4);
+    for (size_t i = 0; i < report.samples.size(); i++) {
+        const auto& s = report.samples[i];
+        file << i << "," << s.perturbation.tiltArcmin << "," << s.perturbation.decenterMm << ","
+             << s.perturbation.spacingMm << "," << s.perturbation.conic << ","
+             << s.hits << "," << s.hitPercentage << "," << s.rmsSpotSize << std::endl;
+    }
+    std::cout << "Tolerance samples saved to: " << filename << std::endl;
+}
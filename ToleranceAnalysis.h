@@ -0,0 +1,86 @@
+#ifndef TOLERANCE_ANALYSIS_H
+#define TOLERANCE_ANALYSIS_H
+
+#include "BatchOptimizer.h"
+#include <string>
+#include <vector>
+
+// One-sigma manufacturing errors of the secondary, drawn as independent
+// Gaussians for every Monte Carlo instance. A zero sigma holds that
+// parameter at its nominal value.
+struct ToleranceSpec {
+    float tiltArcmin = 3.0f;   // Rotation about the vertex
+    float decenterMm = 0.1f;   // Shift across the axis (centerY and aperture)
+    float spacingMm = 0.1f;    // Error in mirrorSeparation (secondary along the axis)
+    float conic = 0.02f;       // Error in secondaryK
+    int trials = 1000;
+    unsigned seed = 1;         // Same seed and trial count give the same instances
+};
+
+struct Perturbation {
+    float tiltArcmin = 0.0f;
+    float decenterMm = 0.0f;
+    float spacingMm = 0.0f;
+    float conic = 0.0f;
+};
+
+struct ToleranceSample {
+    Perturbation perturbation;
+    int hits;
+    float hitPercentage;
+    float rmsSpotSize;
+};
+
+struct DistributionSummary {
+    float mean = 0.0f;
+    float stdDev = 0.0f;
+    float p5 = 0.0f;
+    float median = 0.0f;
+    float p95 = 0.0f;
+};
+
+// Effect of one parameter alone at -1 and +1 sigma
+struct ParameterSensitivity {
+    std::string name;
+    float sigma;
+    float rmsMinus, rmsPlus;
+    float hitPercentageMinus, hitPercentagePlus;
+    float rmsSlope;  // d(RMS)/d(parameter), central difference
+};
+
+struct ToleranceReport {
+    int nominalHits = 0;
+    float nominalHitPercentage = 0.0f;
+    float nominalRMS = 0.0f;
+    std::vector<ToleranceSample> samples;
+    DistributionSummary rms;
+    DistributionSummary hitPercentage;
+    std::vector<ParameterSensitivity> sensitivities;
+};
+
+// Monte Carlo tolerance analysis of an evaluated configuration (2-D fan,
+// secondary at its best position). Perturbations only touch the secondary,
+// so each ray's first leg (launch to primary, or straight to the sensor) is
+// traced once and shared by every instance; an instance only re-checks the
+// secondary's obstruction and traces on from the primary. Instances run in
+// parallel, each thread with its own mirrors and generator, seeded per trial
+// so results do not depend on the thread count.
+class ToleranceAnalyzer {
+public:
+    static ToleranceReport analyze(
+        const BatchResult& result,
+        const CameraSensor& camera,
+        int numRays,
+        float rayStartX,
+        float rayYMin,
+        float rayYMax,
+        int maxBounces,
+        const TraceOptions& options,
+        const ToleranceSpec& spec
+    );
+
+    // One row per instance: perturbation, hits and RMS
+    static void saveSamplesToCSV(const ToleranceReport& report, const std::string& filename);
+};
+
+#endif // TOLERANCE_ANALYSIS_H
@@ -0,0 +1,320 @@
+#include "Tracer3D.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+const double INF = std::numeric_limits<double>::infinity();
+const double GOLDEN_ANGLE = M_PI * (3.0 - std::sqrt(5.0));
+
+// Roots of A t^2 + B t + C = 0 in ascending order (INF when missing),
+// using the cancellation-free form of the quadratic formula
+inline void solveQuadratic(double A, double B, double C, double& t1, double& t2) {
+    t1 = INF;
+    t2 = INF;
+    if (std::abs(A) < EPSILON) {
+        if (std::abs(B) > EPSILON) t1 = -C / B;
+        return;
+    }
+    double discriminant = B * B - 4.0 * A * C;
+    if (discriminant < 0.0) return;
+    double q = -0.5 * (B + std::copysign(std::sqrt(discriminant), B));
+    double r1 = q / A;
+    double r2 = (q != 0.0) ? C / q : r1;
+    t1 = std::min(r1, r2);
+    t2 = std::max(r1, r2);
+}
+
+} // namespace
+
+void RayBundle3D::resize(size_t n) {
+    ox.resize(n); oy.resize(n); oz.resize(n);
+    dx.resize(n); dy.resize(n); dz.resize(n);
+    active.resize(n);
+    tPrimary.resize(n); tSecondary.resize(n); tCamera.resize(n);
+}
+
+SpotDiagram::SpotDiagram() : totalRays(0), blockedRays(0) {}
+
+sf::Vector2f SpotDiagram::getCentroid() const {
+    if (points.empty()) return sf::Vector2f(0.0f, 0.0f);
+
+    double cu = 0.0, cv = 0.0;
+    for (const auto& p : points) {
+        cu += p.x;
+        cv += p.y;
+    }
+    return sf::Vector2f(static_cast<float>(cu / points.size()),
+                        static_cast<float>(cv / points.size()));
+}
+
+float SpotDiagram::getRMSSpotSize() const {
+    if (points.size() < 2) return 0.0f;
+
+    sf::Vector2f centroid = getCentroid();
+    double sumSqDist = 0.0;
+    for (const auto& p : points) {
+        double du = p.x - centroid.x;
+        double dv = p.y - centroid.y;
+        sumSqDist += du * du + dv * dv;
+    }
+    return static_cast<float>(std::sqrt(sumSqDist / points.size()));
+}
+
+float SpotDiagram::getRMSStandardError() const {
+    return CameraSensor::computeRMSStandardError(points);
+}
+
+PupilSamples Tracer3D::sampleAnnulus(int numRays, float rMin, float rMax) {
+    PupilSamples pupil;
+    if (numRays <= 0) return pupil;
+
+    pupil.y.resize(numRays);
+    pupil.z.resize(numRays);
+
+    double r2Min = static_cast<double>(rMin) * rMin;
+    double r2Span = static_cast<double>(rMax) * rMax - r2Min;
+    for (int i = 0; i < numRays; i++) {
+        double r = std::sqrt(r2Min + (i + 0.5) / numRays * r2Span);
+        double theta = i * GOLDEN_ANGLE;
+        pupil.y[i] = static_cast<float>(r * std::cos(theta));
+        pupil.z[i] = static_cast<float>(r * std::sin(theta));
+    }
+    return pupil;
+}
+
+void Tracer3D::intersectPrimary(const ParabolicMirror& primary, RayBundle3D& bundle) {
+    const double inv4f = 1.0 / (4.0 * primary.focalLength);
+    const double rOuter = std::max(std::abs(primary.yMin), std::abs(primary.yMax));
+    const double rOuter2 = rOuter * rOuter;
+    const double rHole2 = static_cast<double>(primary.holeRadius) * primary.holeRadius;
+    const double cx = primary.centerX;
+    const size_t n = bundle.size();
+
+    for (size_t i = 0; i < n; i++) {
+        double ox = bundle.ox[i], oy = bundle.oy[i], oz = bundle.oz[i];
+        double dx = bundle.dx[i], dy = bundle.dy[i], dz = bundle.dz[i];
+
+        double A = (dy * dy + dz * dz) * inv4f;
+        double B = dx + 2.0 * (oy * dy + oz * dz) * inv4f;
+        double C = ox - cx + (oy * oy + oz * oz) * inv4f;
+
+        double roots[2];
+        solveQuadratic(A, B, C, roots[0], roots[1]);
+
+        double best = INF;
+        for (double t : roots) {
+            if (t <= EPSILON || t == INF) continue;
+            double y = oy + t * dy, z = oz + t * dz;
+            double rho2 = y * y + z * z;
+            if (rho2 <= rOuter2 && rho2 >= rHole2) {
+                best = t;
+                break;
+            }
+        }
+        bundle.tPrimary[i] = bundle.active[i] ? best : INF;
+    }
+}
+
+void Tracer3D::intersectSecondary(const HyperbolicMirror& secondary, RayBundle3D& bundle) {
+    const double invA2 = 1.0 / (static_cast<double>(secondary.a) * secondary.a);
+    const double invB2 = 1.0 / (static_cast<double>(secondary.b) * secondary.b);
+    const double cx = secondary.centerX, cy = secondary.centerY;
+    const double apertureY = 0.5 * (secondary.yMin + secondary.yMax);
+    const double apertureR = 0.5 * (secondary.yMax - secondary.yMin);
+    const double apertureR2 = apertureR * apertureR + EPSILON;
+    const double branch = secondary.useLeftBranch ? -1.0 : 1.0;
+    const size_t n = bundle.size();
+
+    for (size_t i = 0; i < n; i++) {
+        double ox = bundle.ox[i] - cx, oy = bundle.oy[i] - cy, oz = bundle.oz[i];
+        double dx = bundle.dx[i], dy = bundle.dy[i], dz = bundle.dz[i];
+
+        double A = dx * dx * invA2 - (dy * dy + dz * dz) * invB2;
+        double B = 2.0 * (ox * dx * invA2 - (oy * dy + oz * dz) * invB2);
+        double C = ox * ox * invA2 - (oy * oy + oz * oz) * invB2 - 1.0;
+
+        double roots[2];
+        solveQuadratic(A, B, C, roots[0], roots[1]);
+
+        double best = INF;
+        for (double t : roots) {
+            if (t <= EPSILON || t == INF) continue;
+            if (branch * (ox + t * dx) < 0.0) continue;
+            double ya = oy + t * dy + cy - apertureY;
+            double z = oz + t * dz;
+            if (ya * ya + z * z <= apertureR2) {
+                best = t;
+                break;
+            }
+        }
+        bundle.tSecondary[i] = bundle.active[i] ? best : INF;
+    }
+}
+
+void Tracer3D::intersectCamera(const CameraSensor& camera, RayBundle3D& bundle) {
+    const double sx = std::cos(camera.angle), sy = std::sin(camera.angle);
+    const double nx = -sy, ny = sx;
+    const double cx = camera.center.x, cy = camera.center.y;
+    const double halfWidth = camera.width / 2.0;
+    const size_t n = bundle.size();
+
+    for (size_t i = 0; i < n; i++) {
+        double denom = bundle.dx[i] * nx + bundle.dy[i] * ny;
+        double t = ((cx - bundle.ox[i]) * nx + (cy - bundle.oy[i]) * ny) / denom;
+
+        double px = bundle.ox[i] + t * bundle.dx[i] - cx;
+        double py = bundle.oy[i] + t * bundle.dy[i] - cy;
+        double u = px * sx + py * sy;
+        double v = bundle.oz[i] + t * bundle.dz[i];
+
+        bool valid = bundle.active[i] && std::abs(denom) > EPSILON && t > EPSILON &&
+                     std::abs(u) <= halfWidth && std::abs(v) <= halfWidth;
+        bundle.tCamera[i] = valid ? t : INF;
+    }
+}
+
+SpotDiagram Tracer3D::trace(
+    const ParabolicMirror& primary,
+    const HyperbolicMirror& secondary,
+    const CameraSensor& camera,
+    const PupilSamples& pupil,
+    float rayStartX,
+    int maxBounces,
+    float fieldAngleRad
+) {
+    RayBundle3D bundle;
+    SpotDiagram spot;
+    trace(primary, secondary, camera, pupil, rayStartX, maxBounces, bundle, spot, fieldAngleRad);
+    return spot;
+}
+
+void Tracer3D::trace(
+    const ParabolicMirror& primary,
+    const HyperbolicMirror& secondary,
+    const CameraSensor& camera,
+    const PupilSamples& pupil,
+    float rayStartX,
+    int maxBounces,
+    RayBundle3D& bundle,
+    SpotDiagram& spot,
+    float fieldAngleRad
+) {
+    spot.points.clear();
+    spot.totalRays = 0;
+    spot.blockedRays = 0;
+    traceChunk(primary, secondary, camera, pupil, 0, pupil.size(), rayStartX, maxBounces,
+               bundle, spot, fieldAngleRad);
+}
+
+void Tracer3D::traceChunk(
+    const ParabolicMirror& primary,
+    const HyperbolicMirror& secondary,
+    const CameraSensor& camera,
+    const PupilSamples& pupil,
+    size_t begin,
+    size_t end,
+    float rayStartX,
+    int maxBounces,
+    RayBundle3D& bundle,
+    SpotDiagram& spot,
+    float fieldAngleRad
+) {
+    const size_t n = end - begin;
+    bundle.resize(n);
+    const int blockedBefore = spot.blockedRays;
+
+    const double launchDx = std::cos(fieldAngleRad);
+    const double launchDy = std::sin(fieldAngleRad);
+    const double pupilShift = -(primary.centerX - rayStartX) * std::tan(fieldAngleRad);
+
+    for (size_t i = 0; i < n; i++) {
+        bundle.ox[i] = rayStartX;
+        bundle.oy[i] = pupil.y[begin + i] + pupilShift;
+        bundle.oz[i] = pupil.z[begin + i];
+        bundle.dx[i] = launchDx;
+        bundle.dy[i] = launchDy;
+        bundle.dz[i] = 0.0;
+        bundle.active[i] = 1;
+    }
+
+    const double sx = std::cos(camera.angle), sy = std::sin(camera.angle);
+    size_t activeCount = n;
+
+    for (int bounce = 0; bounce < maxBounces && activeCount > 0; bounce++) {
+        // Same rule as the 2-D tracers: mirrors are ignored from the third segment on
+        bool isGreenRay = (bounce >= 2);
+        if (isGreenRay) {
+            std::fill(bundle.tPrimary.begin(), bundle.tPrimary.end(), INF);
+            std::fill(bundle.tSecondary.begin(), bundle.tSecondary.end(), INF);
+        } else {
+            intersectPrimary(primary, bundle);
+            intersectSecondary(secondary, bundle);
+        }
+        intersectCamera(camera, bundle);
+
+        for (size_t i = 0; i < n; i++) {
+            if (!bundle.active[i]) continue;
+
+            double tP = bundle.tPrimary[i], tS = bundle.tSecondary[i], tC = bundle.tCamera[i];
+            double tMin = std::min(tP, std::min(tS, tC));
+
+            if (tMin == INF) {
+                bundle.active[i] = 0;
+                activeCount--;
+                continue;
+            }
+
+            double hx = bundle.ox[i] + tMin * bundle.dx[i];
+            double hy = bundle.oy[i] + tMin * bundle.dy[i];
+            double hz = bundle.oz[i] + tMin * bundle.dz[i];
+
+            if (tMin == tC) {
+                double u = (hx - camera.center.x) * sx + (hy - camera.center.y) * sy;
+                spot.points.emplace_back(static_cast<float>(u), static_cast<float>(hz));
+                bundle.active[i] = 0;
+                activeCount--;
+                continue;
+            }
+
+            double nx, ny, nz;
+            if (tMin == tS) {
+                // Secondary obstructs the incoming beam
+                if (bounce == 0) {
+                    spot.blockedRays++;
+                    bundle.active[i] = 0;
+                    activeCount--;
+                    continue;
+                }
+                nx = (hx - secondary.centerX) / (static_cast<double>(secondary.a) * secondary.a);
+                ny = -(hy - secondary.centerY) / (static_cast<double>(secondary.b) * secondary.b);
+                nz = -hz / (static_cast<double>(secondary.b) * secondary.b);
+            } else {
+                nx = 1.0;
+                ny = hy / (2.0 * primary.focalLength);
+                nz = hz / (2.0 * primary.focalLength);
+            }
+
+            double mag = std::sqrt(nx * nx + ny * ny + nz * nz);
+            nx /= mag; ny /= mag; nz /= mag;
+
+            double dot = bundle.dx[i] * nx + bundle.dy[i] * ny + bundle.dz[i] * nz;
+            if (dot > 0.0) {
+                nx = -nx; ny = -ny; nz = -nz;
+                dot = -dot;
+            }
+
+            bundle.dx[i] -= 2.0 * dot * nx;
+            bundle.dy[i] -= 2.0 * dot * ny;
+            bundle.dz[i] -= 2.0 * dot * nz;
+
+            double offset = 1e-5 * (std::abs(hx) + std::abs(hy) + std::abs(hz) + 1.0);
+            bundle.ox[i] = hx + nx * offset;
+            bundle.oy[i] = hy + ny * offset;
+            bundle.oz[i] = hz + nz * offset;
+        }
+    }
+
+    spot.totalRays += static_cast<int>(n) - (spot.blockedRays - blockedBefore);
+}
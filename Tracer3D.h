@@ -0,0 +1,104 @@
+#ifndef TRACER_3D_H
+#define TRACER_3D_H
+
+#include "Mirror.h"
+#include "Camera.h"
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Entrance pupil samples (y, z) on the launch plane x = rayStartX
+struct PupilSamples {
+    std::vector<float> y;
+    std::vector<float> z;
+
+    size_t size() const { return y.size(); }
+};
+
+// Structure-of-arrays ray bundle used by the 3-D tracer
+struct RayBundle3D {
+    std::vector<double> ox, oy, oz;
+    std::vector<double> dx, dy, dz;
+    std::vector<unsigned char> active;
+    std::vector<double> tPrimary, tSecondary, tCamera;  // per-bounce scratch
+
+    void resize(size_t n);
+    size_t size() const { return ox.size(); }
+};
+
+// Result of a 3-D trace: hit positions on the sensor plane
+// (u along the sensor's in-plane width, v along z)
+struct SpotDiagram {
+    std::vector<sf::Vector2f> points;
+    int totalRays;
+    int blockedRays;
+
+    SpotDiagram();
+
+    int getHits() const { return static_cast<int>(points.size()); }
+    sf::Vector2f getCentroid() const;
+    float getRMSSpotSize() const;
+    float getRMSStandardError() const;
+};
+
+// Traces the primary/secondary/camera system as surfaces of revolution
+// about the optical (x) axis. The 2-D mirror objects supply the prescription:
+//   primary:   x = cx - (y^2 + z^2) / 4f, clear between holeRadius and yMax
+//   secondary: (x-cx)^2/a^2 - ((y-cy)^2 + z^2)/b^2 = 1, circular aperture
+//              spanning [yMin, yMax] in the meridional plane
+//   camera:    square sensor of side `width` in the plane through its line
+// Off-axis fields tilt the bundle in the meridional plane, with the pupil
+// re-centred on the primary vertex.
+class Tracer3D {
+public:
+    // Area-uniform (golden-angle spiral) samples over the annulus rMin..rMax
+    static PupilSamples sampleAnnulus(int numRays, float rMin, float rMax);
+
+    static SpotDiagram trace(
+        const ParabolicMirror& primary,
+        const HyperbolicMirror& secondary,
+        const CameraSensor& camera,
+        const PupilSamples& pupil,
+        float rayStartX,
+        int maxBounces = 4,
+        float fieldAngleRad = 0.0f
+    );
+
+    // Same as trace() but reuses caller-owned scratch storage so repeated
+    // evaluations inside an optimizer do not reallocate
+    static void trace(
+        const ParabolicMirror& primary,
+        const HyperbolicMirror& secondary,
+        const CameraSensor& camera,
+        const PupilSamples& pupil,
+        float rayStartX,
+        int maxBounces,
+        RayBundle3D& bundle,
+        SpotDiagram& spot,
+        float fieldAngleRad = 0.0f
+    );
+
+    // Trace pupil samples [begin, end) and append their hits and counts to
+    // spot without clearing it, so callers can stop between chunks
+    static void traceChunk(
+        const ParabolicMirror& primary,
+        const HyperbolicMirror& secondary,
+        const CameraSensor& camera,
+        const PupilSamples& pupil,
+        size_t begin,
+        size_t end,
+        float rayStartX,
+        int maxBounces,
+        RayBundle3D& bundle,
+        SpotDiagram& spot,
+        float fieldAngleRad = 0.0f
+    );
+
+private:
+    // Each fills the matching per-ray distance scratch array in the bundle,
+    // with +inf for inactive rays and misses
+    static void intersectPrimary(const ParabolicMirror& primary, RayBundle3D& bundle);
+    static void intersectSecondary(const HyperbolicMirror& secondary, RayBundle3D& bundle);
+    static void intersectCamera(const CameraSensor& camera, RayBundle3D& bundle);
+};
+
+#endif // TRACER_3D_H
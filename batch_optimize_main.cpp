@@ -1,35 +1,253 @@
 #include "BatchOptimizer.h"
+#include "ToleranceAnalysis.h"
+#include "ParameterSweep.h"
 #include "Camera.h"
 #include <iostream>
 #include <string>
+#include <vector>
+#include <sstream>
 #include <cmath>
 #include <iomanip>
+#include <fstream>
+#include <algorithm>
+
+// Parse a comma-separated list of numbers, e.g. "0,5,10"
+static std::vector<float> parseFloatList(const std::string& text) {
+    std::vector<float> values;
+    std::stringstream ss(text);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        if (!token.empty()) values.push_back(std::stof(token));
+    }
+    return values;
+}
+
+// batch_optimize merge <output> <shard results>... [--top N]
+static int runMerge(int argc, char* argv[]) {
+    int topN = 20;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--top" && i + 1 < argc) {
+            topN = std::stoi(argv[++i]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() < 2) {
+        std::cerr << "Usage: batch_optimize merge <output.csv> <shard.csv>... [--top N]" << std::endl;
+        return 1;
+    }
+    
+    std::string outputFile = files.front();
+    files.erase(files.begin());
+    std::vector<BatchResult> merged = BatchOptimizer::mergeResults(files, topN);
+    if (!BatchOptimizer::saveResultsToCSV(merged, outputFile)) return 1;
+    std::cout << "Results saved to " << outputFile << std::endl;
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::string(argv[1]) == "merge") {
+        return runMerge(argc, argv);
+    }
+    
     std::string inputFile = "cassegrain_optics_grid.csv";
     std::string outputFile = "optimization_results.csv";
     int topN = 20;
     int numRays = 500;  // Reduced for faster batch processing
+    TraceOptions options;
+    std::string cacheFile = "optimization_cache.csv";
+    float focusRange = 0.0f;  // Through-focus sweep half range (mm); 0 = off
+    int focusSteps = 201;
+    std::string focusFile;
+    ToleranceSpec tolerance;
+    tolerance.trials = 0;  // Tolerance analysis of the best result; 0 = off
+    std::string toleranceFile;
+    bool refine = false;  // Damped least-squares refinement of the top results
+    ProgressSettings progress;
+    ShardSpec shard;  // --shard i/N: score one slice and write a partial result file
+    std::string sweepFile;  // Built-in parameter sweep instead of the input CSV
     
-    // Parse command line arguments
-    if (argc >= 2) {
-        inputFile = argv[1];
+    // Parse command line arguments: positional [input] [output] [topN] [numRays]
+    // (with --sweep, which replaces the input CSV: [output] [topN] [numRays]),
+    // plus --flags anywhere on the line
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--3d") {
+            options.trace3D = true;
+        } else if (arg == "--fields" && i + 1 < argc) {
+            options.fields.anglesArcmin = parseFloatList(argv[++i]);
+        } else if (arg == "--field-weights" && i + 1 < argc) {
+            options.fields.weights = parseFloatList(argv[++i]);
+        } else if (arg == "--sampler" && i + 1 < argc) {
+            if (!PupilSampler::parseType(argv[++i], options.sampler.type)) {
+                std::cerr << "Unknown sampler: " << argv[i]
+                          << " (uniform, stratified, halton, sobol, area)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheFile = argv[++i];
+        } else if (arg == "--no-cache") {
+            cacheFile.clear();
+        } else if (arg == "--no-early-exit") {
+            options.earlyTermination = false;
+        } else if (arg == "--objective" && i + 1 < argc) {
+            std::string objective = argv[++i];
+            if (objective == "rms") {
+                options.objective = SpotObjective::RMS;
+            } else if (objective == "ee80") {
+                options.objective = SpotObjective::EE80;
+            } else {
+                std::cerr << "Unknown objective: " << objective << " (rms, ee80)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--focus-sweep" && i + 1 < argc) {
+            focusRange = std::stof(argv[++i]);
+        } else if (arg == "--focus-steps" && i + 1 < argc) {
+            focusSteps = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--focus-curves" && i + 1 < argc) {
+            focusFile = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance.trials = std::stoi(argv[++i]);
+        } else if (arg == "--tol-tilt" && i + 1 < argc) {
+            tolerance.tiltArcmin = std::stof(argv[++i]);
+        } else if (arg == "--tol-decenter" && i + 1 < argc) {
+            tolerance.decenterMm = std::stof(argv[++i]);
+        } else if (arg == "--tol-spacing" && i + 1 < argc) {
+            tolerance.spacingMm = std::stof(argv[++i]);
+        } else if (arg == "--tol-conic" && i + 1 < argc) {
+            tolerance.conic = std::stof(argv[++i]);
+        } else if (arg == "--tolerance-csv" && i + 1 < argc) {
+            toleranceFile = argv[++i];
+        } else if (arg == "--refine") {
+            refine = true;
+        } else if (arg == "--screen") {
+            options.screening.enabled = true;
+        } else if (arg == "--screen-samples" && i + 1 < argc) {
+            options.screening.initialSamples = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--screen-batch" && i + 1 < argc) {
+            options.screening.batchSize = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--screen-confidence" && i + 1 < argc) {
+            options.screening.confidence = std::stof(argv[++i]);
+        } else if (arg == "--warm-start") {
+            options.warmStart = true;
+        } else if (arg == "--no-symmetry") {
+            options.exploitSymmetry = false;
+        } else if (arg == "--non-sequential") {
+            options.traceMode = TraceMode::NonSequential;
+        } else if (arg == "--prefilter" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "off") {
+                options.prefilter = PrefilterMode::Off;
+            } else if (mode == "standard") {
+                options.prefilter = PrefilterMode::Standard;
+            } else if (mode == "strict") {
+                options.prefilter = PrefilterMode::Strict;
+            } else {
+                std::cerr << "Unknown pre-filter mode: " << mode << " (off, standard, strict)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            sweepFile = argv[++i];
+        } else if (arg == "--shard" && i + 1 < argc) {
+            if (!ShardSpec::parse(argv[++i], shard)) {
+                std::cerr << "Invalid shard: " << argv[i] << " (expected i/N with 0 <= i < N)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--shard-by" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "hash") {
+                shard.byHash = true;
+            } else if (mode == "range") {
+                shard.byHash = false;
+            } else {
+                std::cerr << "Unknown shard mode: " << mode << " (range, hash)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--progress-interval" && i + 1 < argc) {
+            progress.intervalSeconds = std::stod(argv[++i]);
+        } else if (arg == "--status-file" && i + 1 < argc) {
+            progress.statusFile = argv[++i];
+        } else if (arg == "--target-error" && i + 1 < argc) {
+            options.targetScoreError = std::stof(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            options.sampler.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--field-score" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "weighted") {
+                options.fields.scoring = FieldScoring::WeightedField;
+            } else if (mode == "worst") {
+                options.fields.scoring = FieldScoring::WorstField;
+            } else {
+                std::cerr << "Unknown field scoring: " << mode << " (worst, weighted)" << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
     }
-    if (argc >= 3) {
-        outputFile = argv[2];
+    
+    size_t first = sweepFile.empty() ? 1 : 0;  // Index of [output]
+    if (first == 1 && positional.size() >= 1) {
+        inputFile = positional[0];
+    }
+    if (positional.size() >= first + 1) {
+        outputFile = positional[first];
     }
-    if (argc >= 4) {
-        topN = std::stoi(argv[3]);
+    if (positional.size() >= first + 2) {
+        topN = std::stoi(positional[first + 1]);
     }
-    if (argc >= 5) {
-        numRays = std::stoi(argv[4]);
+    if (positional.size() >= first + 3) {
+        numRays = std::stoi(positional[first + 2]);
+    }
+    // The running top N replaces the output file as the run goes, for the GUI to follow
+    progress.resultsFile = outputFile;
+    
+    if (options.targetScoreError > 0.0f && (options.sampler.type == SamplerType::Uniform ||
+                                             options.sampler.type == SamplerType::AreaWeighted)) {
+        std::cerr << "--target-error needs a random sampler (stratified, halton, sobol); "
+                  << PupilSampler::typeName(options.sampler.type) << " has no sampling error" << std::endl;
+        return 1;
     }
     
     std::cout << "=== Cassegrain Telescope Batch Optimizer ===" << std::endl;
-    std::cout << "Input CSV: " << inputFile << std::endl;
+    ParameterSweep sweep;
+    if (!sweepFile.empty()) {
+        if (!sweep.load(sweepFile)) return 1;
+        std::cout << "Sweep spec: " << sweepFile << " (" << sweep.describe() << ")" << std::endl;
+    } else {
+        std::cout << "Input CSV: " << inputFile << std::endl;
+    }
     std::cout << "Output CSV: " << outputFile << std::endl;
     std::cout << "Top N configurations: " << topN << std::endl;
     std::cout << "Rays per test: " << numRays << std::endl;
+    if (!options.fields.empty()) {
+        std::cout << "Field angles (arcmin):";
+        for (float angle : options.fields.anglesArcmin) std::cout << " " << angle;
+        std::cout << " [" << (options.fields.scoring == FieldScoring::WeightedField ? "weighted" : "worst")
+                  << "-field scoring]" << std::endl;
+    }
+    std::cout << "Pupil sampler: " << PupilSampler::typeName(options.sampler.type)
+              << " (seed " << options.sampler.seed << ")" << std::endl;
+    if (options.targetScoreError > 0.0f) {
+        std::cout << "Target score error: " << options.targetScoreError << " (up to "
+                  << (numRays << BatchOptimizer::MAX_RAY_DOUBLINGS) << " rays per test)" << std::endl;
+    }
+    std::cout << "Trace mode: " << (options.trace3D ? "3-D (annular pupil)" : "2-D (meridional fan)") << std::endl;
+    std::cout << "Objective: " << (options.objective == SpotObjective::EE80 ? "EE80 radius" : "RMS spot") << std::endl;
+    if (options.screening.enabled) {
+        std::cout << "Surrogate screening (approximate): " << options.screening.initialSamples
+                  << " initial samples, " << options.screening.confidence
+                  << " x leave-one-out margin" << std::endl;
+    }
+    if (focusRange > 0.0f) {
+        std::cout << "Through-focus: +/-" << focusRange << " mm in " << focusSteps << " steps" << std::endl;
+    }
     std::cout << "=============================================" << std::endl << std::endl;
     
     // Create camera sensor with specifications
@@ -41,16 +259,62 @@ int main(int argc, char* argv[]) {
     );
     
     // Run batch optimization
-    std::vector<BatchResult> results = BatchOptimizer::optimizeBatch(
-        inputFile,
-        &camera,
-        numRays,
-        -50.0f,   // Ray start X
-        -120.0f,  // Ray Y min
-        120.0f,   // Ray Y max
-        4,        // Max bounces
-        topN
-    );
+    std::vector<BatchResult> results;
+    if (!sweepFile.empty()) {
+        results = BatchOptimizer::optimizeSweep(
+            sweep, &camera, numRays, -50.0f, -120.0f, 120.0f, 4,
+            topN, options, cacheFile, progress, shard
+        );
+    } else {
+        results = BatchOptimizer::optimizeBatch(
+            inputFile,
+            &camera,
+            numRays,
+            -50.0f,   // Ray start X
+            -120.0f,  // Ray Y min
+            120.0f,   // Ray Y max
+            4,        // Max bounces
+            topN,
+            options,
+            cacheFile,
+            progress,
+            shard
+        );
+    }
+    
+    if (refine) {
+        std::cout << "\n=== Damped Least-Squares Refinement ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(4);
+        for (size_t i = 0; i < results.size(); i++) {
+            DampedLeastSquaresResult refined;
+            RefineOutcome outcome = BatchOptimizer::refineResult(
+                results[i], refined, camera, numRays, -50.0f, -120.0f, 120.0f, 4, options);
+            if (outcome == RefineOutcome::Skipped) {
+                std::cout << "  Skipped: --refine uses the on-axis 2-D fan, not 3-D / field runs" << std::endl;
+                break;
+            }
+            std::cout << "  Row " << results[i].config.rowIndex << ": RMS " << refined.startRMS
+                      << " -> " << refined.rmsSpotSize << " mm (" << refined.iterations
+                      << " iterations, " << refined.traces << " traces";
+            if (refined.mismatches > 0) {
+                std::cout << "; stopped early, " << refined.mismatches << " rays off the gradient model";
+            }
+            std::cout << ")";
+            if (outcome == RefineOutcome::Rejected) std::cout << ", kept the original (lower score)";
+            std::cout << std::endl;
+        }
+        std::sort(results.begin(), results.end(), BatchOptimizer::ranksAbove);
+    }
+    
+    // Through-focus curves for the results shown below, each from one trace
+    std::vector<FocusCurve> focusCurves;
+    if (focusRange > 0.0f) {
+        for (size_t i = 0; i < results.size() && i < 10; i++) {
+            focusCurves.push_back(BatchOptimizer::throughFocus(results[i], camera, numRays,
+                                                               -50.0f, -120.0f, 120.0f, 4,
+                                                               options, focusRange, focusSteps));
+        }
+    }
     
     // Display top results
     std::cout << "\n=== Top " << results.size() << " Configurations ===" << std::endl;
@@ -59,9 +323,17 @@ int main(int argc, char* argv[]) {
     for (size_t i = 0; i < results.size() && i < 10; i++) {
         const auto& r = results[i];
         std::cout << "\nRank #" << (i + 1) << ":" << std::endl;
-        std::cout << "  Score: " << r.score << std::endl;
+        // No error bars for the deterministic samplers: their ranking is exact
+        std::cout << "  Score: " << r.score;
+        if (!std::isnan(r.scoreError)) std::cout << " +/- " << r.scoreError;
+        std::cout << std::endl;
         std::cout << "  Camera Hits: " << r.cameraHits << " (" << r.hitPercentage << "%)" << std::endl;
-        std::cout << "  RMS Spot: " << r.rmsSpotSize << " mm" << std::endl;
+        std::cout << "  RMS Spot: " << r.rmsSpotSize;
+        if (!std::isnan(r.rmsError)) std::cout << " +/- " << r.rmsError;
+        std::cout << " mm" << std::endl;
+        if (!std::isnan(r.ee50)) {
+            std::cout << "  EE50/EE80: " << r.ee50 * 1000.0f << " / " << r.ee80 * 1000.0f << " um" << std::endl;
+        }
         std::cout << "  Primary: " << r.config.primaryDiameter << "mm diam, "
                  << "f=" << r.config.primaryF << "mm" << std::endl;
         std::cout << "  Secondary: " << r.config.secondaryDiameter << "mm diam, "
@@ -70,10 +342,66 @@ int main(int argc, char* argv[]) {
         std::cout << "  System f: " << r.config.systemFocalLength << "mm" << std::endl;
         std::cout << "  Best Secondary Pos: X=" << r.bestSecondaryX 
                  << ", Y=" << r.bestSecondaryY << std::endl;
+        if (i < focusCurves.size() && focusCurves[i].bestIndex >= 0) {
+            const FocusCurve& curve = focusCurves[i];
+            std::cout << "  Best Focus: " << std::showpos << curve.bestOffset << std::noshowpos
+                      << "mm (RMS " << std::setprecision(4) << curve.bestRMS << " mm, "
+                      << curve.bestHits << " hits)" << std::setprecision(2) << std::endl;
+        }
+    }
+    
+    if (!focusFile.empty() && !focusCurves.empty()) {
+        std::ofstream file(focusFile);
+        if (!file.is_open()) {
+            std::cerr << "Failed to create focus curve file: " << focusFile << std::endl;
+        } else {
+            file << "Rank,FocusOffset,CameraHits,RMSSpotSize" << std::endl;
+            file << std::fixed << std::setprecision(4);
+            for (size_t i = 0; i < focusCurves.size(); i++) {
+                for (const auto& point : focusCurves[i].points) {
+                    file << (i + 1) << "," << point.offset << "," << point.hits << ","
+                         << point.rmsSpotSize << std::endl;
+                }
+            }
+            std::cout << "\nFocus curves saved to: " << focusFile << std::endl;
+        }
+    }
+    
+    if (tolerance.trials > 0 && !results.empty()) {
+        tolerance.seed = options.sampler.seed;
+        ToleranceReport report = ToleranceAnalyzer::analyze(results[0], camera, numRays,
+                                                            -50.0f, -120.0f, 120.0f, 4,
+                                                            options, tolerance);
+        
+        std::cout << "\n=== Tolerance Analysis (Rank #1, " << tolerance.trials << " instances) ===" << std::endl;
+        std::cout << "  Sigma: tilt " << tolerance.tiltArcmin << " arcmin, decenter "
+                  << tolerance.decenterMm << " mm, spacing " << tolerance.spacingMm
+                  << " mm, conic " << tolerance.conic << std::endl;
+        std::cout << std::setprecision(4);
+        std::cout << "  Nominal: " << report.nominalHitPercentage << "% hits, RMS "
+                  << report.nominalRMS << " mm" << std::endl;
+        std::cout << "  RMS (mm): mean " << report.rms.mean << " +/- " << report.rms.stdDev
+                  << ", median " << report.rms.median << ", 95th pct " << report.rms.p95 << std::endl;
+        std::cout << "  Hits (%): mean " << report.hitPercentage.mean << " +/- "
+                  << report.hitPercentage.stdDev << ", median " << report.hitPercentage.median
+                  << ", 5th pct " << report.hitPercentage.p5 << std::endl;
+        std::cout << "  Sensitivities (one parameter at -/+ 1 sigma):" << std::endl;
+        for (const auto& s : report.sensitivities) {
+            std::cout << "    " << std::left << std::setw(15) << s.name << std::right
+                      << " RMS " << s.rmsMinus << " / " << s.rmsPlus
+                      << " mm, hits " << s.hitPercentageMinus << " / " << s.hitPercentagePlus
+                      << "%, dRMS/dp " << s.rmsSlope << std::endl;
+        }
+        std::cout << std::setprecision(2);
+        
+        if (!toleranceFile.empty()) {
+            ToleranceAnalyzer::saveSamplesToCSV(report, toleranceFile);
+        }
     }
     
     // Save all results to CSV
-    BatchOptimizer::saveResultsToCSV(results, outputFile);
+    // Shard files keep full precision so merging them matches a single run
+    if (!BatchOptimizer::saveResultsToCSV(results, outputFile, shard.count > 1)) return 1;
     
     std::cout << "\n=== Optimization Complete ===" << std::endl;
     std::cout << "Full results saved to: " << outputFile << std::endl;
@@ -4,6 +4,8 @@
 #include "Optimizer.h"
 #include "BatchOptimizer.h"
 #include "ConfigBuilder.h"
+#include "ResultsWatcher.h"
+#include "ParameterSweep.h"
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <memory>
@@ -11,14 +13,17 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <array>
 
-const int NUM_RAYS = 50;
+const int NUM_RAYS = 50;     // Rays per trace in the optimizers
+const int MAX_RAYS = 5000;   // Upper end of the ray count slider
 
 class Button {
 public:
     sf::RectangleShape shape;
     sf::Text label;
     bool isPressed;
+    bool changed;  // Appearance changed since the last takeChanged()
     sf::Vector2f basePosition;
     sf::Vector2f baseSize;
 
@@ -44,13 +49,21 @@ public:
         );
 
         isPressed = false;
+        changed = true;
     }
 
     bool contains(sf::Vector2f pos) {
         return shape.getGlobalBounds().contains(pos);
     }
 
+    bool takeChanged() {
+        bool wasChanged = changed;
+        changed = false;
+        return wasChanged;
+    }
+
     void setPressed(bool pressed) {
+        if (pressed != isPressed) changed = true;
         isPressed = pressed;
         if (pressed) {
             shape.setFillColor(sf::Color(30, 80, 150));
@@ -70,6 +83,7 @@ public:
     sf::CircleShape shape;
     sf::Text label;
     bool isHovered;
+    bool changed;  // Appearance changed since the last takeChanged()
     float incrementValue;
     sf::Vector2f basePosition;
     float baseRadius;
@@ -84,6 +98,7 @@ public:
         shape.setOutlineColor(sf::Color::White);
         shape.setOutlineThickness(2);
         isHovered = false;
+        changed = true;
         incrementValue = incValue;
         
         label.setFont(font);
@@ -107,7 +122,14 @@ public:
         return (dx * dx + dy * dy) <= (shape.getRadius() * shape.getRadius());
     }
     
+    bool takeChanged() {
+        bool wasChanged = changed;
+        changed = false;
+        return wasChanged;
+    }
+    
     void setHighlight(bool highlight) {
+        if (highlight != isHovered) changed = true;
         isHovered = highlight;
         if (highlight) {
             shape.setFillColor(sf::Color(90, 170, 255));
@@ -131,12 +153,15 @@ public:
     float minVal, maxVal, currentVal;
     float stepSize;
     bool isDragging;
+    bool changed;  // Value or layout changed since the last takeChanged()
     sf::Vector2f position;
     float width;
     sf::Vector2f basePosition;
     float baseWidth;
+    int decimals;
 
-    Slider(float x, float y, float w, float min, float max, float init, const std::string& text, sf::Font& font, float step = 1.0f) {
+    Slider(float x, float y, float w, float min, float max, float init, const std::string& text, sf::Font& font,
+           float step = 1.0f, int valueDecimals = 5) {
         basePosition = sf::Vector2f(x, y);
         baseWidth = w;
         position = sf::Vector2f(x, y);
@@ -145,7 +170,9 @@ public:
         maxVal = max;
         currentVal = init;
         stepSize = step;
+        decimals = valueDecimals;
         isDragging = false;
+        changed = true;
 
         track.setSize(sf::Vector2f(w * 2, 8));
         track.setPosition(x, y);
@@ -172,11 +199,40 @@ public:
         float ratio = (currentVal - minVal) / (maxVal - minVal);
         handle.setPosition(position.x + ratio * width, position.y + 4);
         updateValueText();
+        changed = true;
+    }
+
+    bool takeChanged() {
+        bool wasChanged = changed;
+        changed = false;
+        return wasChanged;
+    }
+
+    // Clamped to the range; not rounded to the step
+    void setValue(float value) {
+        currentVal = std::max(minVal, std::min(maxVal, value));
+        updateHandlePosition();
+    }
+
+    void setRange(float min, float max) {
+        minVal = min;
+        maxVal = max;
+        setValue(currentVal);
+    }
+
+    // Place the slider for a window scaled by (scaleX, scaleY) from the base size
+    void layout(float scaleX, float scaleY) {
+        position = sf::Vector2f(basePosition.x * scaleX, basePosition.y * scaleY);
+        track.setPosition(position);
+        label.setPosition(position.x, position.y - 40);
+        width = baseWidth * 2 * scaleX;
+        track.setSize(sf::Vector2f(width, 8));
+        updateHandlePosition();
     }
 
     void updateValueText() {
         std::stringstream ss;
-        ss << std::fixed << std::setprecision(5) << currentVal;
+        ss << std::fixed << std::setprecision(decimals) << currentVal;
         valueText.setString(ss.str());
         valueText.setPosition(position.x + width + 20, position.y - 16);
     }
@@ -214,17 +270,126 @@ public:
     }
 };
 
+// Sliders for the geometry of the shown configuration, the sensor position
+// and the number of rays. They edit a copy of the configuration; main writes
+// it into the existing mirrors in place, so dragging one only retraces.
+class GeometryPanel {
+public:
+    Slider primaryDiameter;
+    Slider primaryF;
+    Slider secondaryDiameter;
+    Slider secondaryR;
+    Slider secondaryK;
+    Slider mirrorSeparation;
+    Slider cameraX;   // Sensor distance behind the primary vertex
+    Slider cameraY;
+    Slider rayCount;
+    OpticalConfig edited;
+    OpticalConfig loaded;  // As last load()ed, for rescaling its focal length
+
+    GeometryPanel(float x, float y, float spacing, sf::Font& font)
+        : primaryDiameter(x, y, 130, 1, 2, 1, "Primary D (mm)", font, 0.1f, 1),
+          primaryF(x, y + spacing, 130, 1, 2, 1, "Primary f (mm)", font, 0.1f, 1),
+          secondaryDiameter(x, y + 2 * spacing, 130, 1, 2, 1, "Secondary D (mm)", font, 0.1f, 1),
+          secondaryR(x, y + 3 * spacing, 130, -2, -1, -1, "Secondary R (mm)", font, 0.1f, 1),
+          secondaryK(x, y + 4 * spacing, 130, -4, -1.01f, -2, "Secondary K", font, 0.001f, 3),
+          mirrorSeparation(x, y + 5 * spacing, 130, 1, 2, 1, "Separation (mm)", font, 0.1f, 1),
+          cameraX(x, y + 6 * spacing, 130, -200, 400, 40, "Sensor X (mm)", font, 0.1f, 1),
+          cameraY(x, y + 7 * spacing, 130, -20, 20, 0, "Sensor Y (mm)", font, 0.01f, 2),
+          rayCount(x, y + 8 * spacing, 130, 10, MAX_RAYS, NUM_RAYS, "Rays", font, 1.0f, 0) {}
+
+    std::array<Slider*, 9> sliders() {
+        return {&primaryDiameter, &primaryF, &secondaryDiameter, &secondaryR, &secondaryK,
+                &mirrorSeparation, &cameraX, &cameraY, &rayCount};
+    }
+
+    // Start editing config, with each range spanning the useful values
+    // around the loaded one
+    void load(const OpticalConfig& config) {
+        edited = config;
+        loaded = config;
+        span(primaryDiameter, config.primaryDiameter * 0.25f, config.primaryDiameter * 2.0f);
+        span(primaryF, config.primaryF * 0.5f, config.primaryF * 1.5f);
+        span(secondaryDiameter, config.secondaryDiameter * 0.25f, config.secondaryDiameter * 2.0f);
+        span(secondaryR, std::min(config.secondaryR * 2.0f, config.secondaryR * 0.5f),
+             std::max(config.secondaryR * 2.0f, config.secondaryR * 0.5f));
+        // K = -1 is a paraboloid, which buildTelescopeFromConfig cannot make
+        span(secondaryK, std::min(config.secondaryK, -1.01f) - 3.0f, std::max(config.secondaryK, -1.01f));
+        span(mirrorSeparation, std::min(0.0f, config.mirrorSeparation), std::abs(config.mirrorSeparation) * 2.0f);
+        for (auto& [slider, field] : fields()) {
+            slider->setValue(config.*field);
+            slider->takeChanged();
+        }
+    }
+
+    // Copy the sliders moved since the last call into edited and refresh the
+    // derived fields. True if anything moved, sensor and ray count included.
+    bool takeChanged() {
+        bool moved = false;
+        bool modified = false;
+        for (auto& [slider, field] : fields()) {
+            if (slider->takeChanged() && slider->getValue() != edited.*field) {
+                edited.*field = slider->getValue();
+                modified = true;
+            }
+        }
+        for (Slider* slider : {&cameraX, &cameraY, &rayCount}) {
+            if (slider->takeChanged()) moved = true;
+        }
+        if (modified) {
+            edited.primaryR = 2.0f * edited.primaryF;
+            edited.secondaryF = edited.secondaryR / 2.0f;
+            // Scale the loaded focal length by the change in the paraxial
+            // model, so the readouts move smoothly from the loaded value
+            // whatever convention its source used
+            float before = ParameterSweep::paraxialFocalLength(loaded);
+            float after = ParameterSweep::paraxialFocalLength(edited);
+            edited.systemFocalLength = before != 0.0f ? loaded.systemFocalLength * after / before : after;
+        }
+        return moved || modified;
+    }
+
+    int rays() const {
+        return static_cast<int>(rayCount.getValue());
+    }
+
+private:
+    std::array<std::pair<Slider*, float OpticalConfig::*>, 6> fields() {
+        return {{{&primaryDiameter, &OpticalConfig::primaryDiameter},
+                 {&primaryF, &OpticalConfig::primaryF},
+                 {&secondaryDiameter, &OpticalConfig::secondaryDiameter},
+                 {&secondaryR, &OpticalConfig::secondaryR},
+                 {&secondaryK, &OpticalConfig::secondaryK},
+                 {&mirrorSeparation, &OpticalConfig::mirrorSeparation}}};
+    }
+
+    // Degenerate values (zero, non-finite) still get a usable range
+    static void span(Slider& slider, float min, float max) {
+        if (!(max > min)) {
+            min = -1.0f;
+            max = 1.0f;
+        }
+        slider.setRange(min, max);
+    }
+};
+
 class Scene {
 public:
     std::vector<std::unique_ptr<Mirror>> mirrors;
     CameraSensor* camera;
     std::vector<Ray> rays;
+    RayPathBuffer pathBuffer;  // Backing store for every ray's path this frame
+    sf::VertexArray rayVertices;  // Every ray segment of the frame, drawn in one call
+    bool geometryChanged;  // Mirrors moved or rebuilt: rays must be retraced
+    bool viewChanged;      // Pan, zoom or resize: redraw without retracing
     sf::Vector2f offset;
     float scale;
     sf::Vector2f baseOffset;
     float baseScale;
 
-    Scene(sf::Vector2f off, float sc) : camera(nullptr), offset(off), scale(sc), 
+    Scene(sf::Vector2f off, float sc) : camera(nullptr), rayVertices(sf::Lines),
+                                        geometryChanged(true), viewChanged(true),
+                                        offset(off), scale(sc),
                                         baseOffset(off), baseScale(sc) {}
 
     void updateScale(float windowWidth, float windowHeight, float baseWidth, float baseHeight) {
@@ -234,6 +399,7 @@ public:
         
         scale = baseScale * uniformScale;
         offset = sf::Vector2f(baseOffset.x * scaleX, baseOffset.y * scaleY);
+        viewChanged = true;
     }
 
     void addMirror(std::unique_ptr<Mirror> mirror) {
@@ -302,20 +468,21 @@ public:
         }
     }
 
-    void drawRay(sf::RenderWindow& window, const Ray& ray) const {
-        if (ray.bounces < 0) return;
-        
-        for (size_t i = 0; i < ray.path.size() - 1; i++) {
-            sf::Color segColor = (i == 0 ? sf::Color::Red
-                                  : i == 1 ? sf::Color::Blue
-                                  : i == 2 ? sf::Color::Green
-                                  : sf::Color(200, 200, 200, 180));
-            sf::Vertex line[] = {
-                sf::Vertex(worldToScreen(ray.path[i]), segColor),
-                sf::Vertex(worldToScreen(ray.path[i + 1]), segColor)
-            };
-            window.draw(line, 2, sf::Lines);
+    void drawRays(sf::RenderWindow& window) {
+        rayVertices.clear();
+        for (const auto& ray : rays) {
+            if (ray.bounces < 0) continue;
+            
+            for (size_t i = 0; i + 1 < ray.path.size(); i++) {
+                sf::Color segColor = (i == 0 ? sf::Color::Red
+                                      : i == 1 ? sf::Color::Blue
+                                      : i == 2 ? sf::Color::Green
+                                      : sf::Color(200, 200, 200, 180));
+                rayVertices.append(sf::Vertex(worldToScreen(ray.path[i]), segColor));
+                rayVertices.append(sf::Vertex(worldToScreen(ray.path[i + 1]), segColor));
+            }
         }
+        window.draw(rayVertices);
     }
 
     sf::Vector2f worldToScreen(sf::Vector2f worldPos) const {
@@ -325,14 +492,15 @@ public:
 
 void rebuildConfiguration(std::vector<OpticalConfig>& availableConfigs, int currentConfigIndex,
                          Scene& scene, float primaryCenterX, Slider& sliderSecondaryX, 
-                         Slider& sliderSecondaryY) {
+                         Slider& sliderSecondaryY, GeometryPanel& panel) {
     scene.mirrors.clear();
     
     ConfigBuilder::buildTelescopeFromConfig(availableConfigs[currentConfigIndex],
                                            scene.mirrors, scene.camera, primaryCenterX);
+    panel.load(availableConfigs[currentConfigIndex]);
     
     auto newCamera = std::make_unique<CameraSensor>(
-        sf::Vector2f(primaryCenterX + 40.0f, 0.0f), 
+        sf::Vector2f(primaryCenterX + panel.cameraX.getValue(), panel.cameraY.getValue()), 
         11.2f,
         M_PI / 2.0f, "Camera"
     );
@@ -346,6 +514,7 @@ void rebuildConfiguration(std::vector<OpticalConfig>& availableConfigs, int curr
         sliderSecondaryX.updateHandlePosition();
         sliderSecondaryY.updateHandlePosition();
     }
+    scene.geometryChanged = true;
 }
 
 int main() {
@@ -360,7 +529,12 @@ int main() {
 
     std::vector<OpticalConfig> availableConfigs;
     std::string configFile = "optimization_results.csv";
-    availableConfigs = BatchOptimizer::loadResultsFromCSV(configFile);
+    
+    // Follows the results file so a running batch_optimize shows up live
+    ResultsWatcher resultsWatcher(configFile);
+    availableConfigs = resultsWatcher.loadInitial();
+    bool usingDefaultConfig = availableConfigs.empty();
+    bool showFirstOnReload = false;
     
     if (availableConfigs.empty()) {
         std::cout << "No optimization results found. Using default configuration." << std::endl;
@@ -379,6 +553,7 @@ int main() {
         defaultConfig.bestSecondaryY = 0.0f;
         availableConfigs.push_back(defaultConfig);
     }
+    resultsWatcher.start();
     
     int currentConfigIndex = 0;
     float primaryCenterX = 1400.0f;
@@ -392,6 +567,10 @@ int main() {
 
     Slider sliderSecondaryX(50, 850, 280, -2000, 2000, 250, "Secondary X (mm)", font, 0.001f);
     Slider sliderSecondaryY(50, 930, 280, -20, 20, 0, "Secondary Y (mm)", font, 0.001f);
+    GeometryPanel panel(1360, 130, 78, font);
+
+    std::vector<Slider*> sliders = {&sliderSecondaryX, &sliderSecondaryY};
+    for (Slider* slider : panel.sliders()) sliders.push_back(slider);
     
     Button prevConfigButton(450, 850, 80, 30, "< Prev", font);
     Button nextConfigButton(450, 920, 80, 30, "Next >", font);
@@ -416,19 +595,40 @@ int main() {
     OptimizationResult lastOptResult;
 
     Scene scene(sf::Vector2f(100, 500), 0.7f);
+    // Origin, up to four reflections and the final extension per ray, for
+    // the most rays the slider allows: retracing never reallocates
+    scene.rays.reserve(MAX_RAYS);
+    scene.pathBuffer.reserve(MAX_RAYS * 6);
     
     rebuildConfiguration(availableConfigs, currentConfigIndex, scene, primaryCenterX, 
-                        sliderSecondaryX, sliderSecondaryY);
+                        sliderSecondaryX, sliderSecondaryY, panel);
 
     bool isPanning = false;
     sf::Vector2f lastMousePos;
 
+    // Render on demand: block in waitEvent while idle, and only retrace or
+    // rebuild the HUD text when something they depend on has changed
+    bool redrawNeeded = true;
+    bool hudChanged = true;
+    std::vector<sf::Text> hud;
+
     while (window.isOpen()) {
         sf::Event event;
-        while (window.pollEvent(event)) {
+        bool haveEvent = window.pollEvent(event);
+        // Idle: nap until input arrives or the watcher has parsed new rows
+        // (SFML's waitEvent cannot be woken from the watcher thread)
+        while (!haveEvent && !redrawNeeded && window.isOpen() && !resultsWatcher.hasUpdate()) {
+            sf::sleep(sf::milliseconds(30));
+            haveEvent = window.pollEvent(event);
+        }
+        for (; haveEvent; haveEvent = window.pollEvent(event)) {
             if (event.type == sf::Event::Closed) 
                 window.close();
 
+            if (event.type == sf::Event::GainedFocus) {
+                redrawNeeded = true;
+            }
+
             // Mouse wheel zoom
             if (event.type == sf::Event::MouseWheelScrolled) {
                 if (event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
@@ -447,6 +647,7 @@ int main() {
                     scene.offset.x += (worldPosAfter.x - worldPosBefore.x) * scene.scale;
                     scene.offset.y -= (worldPosAfter.y - worldPosBefore.y) * scene.scale;
                     scene.baseOffset = scene.offset;
+                    scene.viewChanged = true;
                 }
             }
 
@@ -459,22 +660,9 @@ int main() {
                 uiScaleY = windowSize.y / BASE_HEIGHT;
                 
                 scene.updateScale(windowSize.x, windowSize.y, BASE_WIDTH, BASE_HEIGHT);
+                hudChanged = true;
                 
-                sliderSecondaryX.position = sf::Vector2f(sliderSecondaryX.basePosition.x * uiScaleX, 
-                                                         sliderSecondaryX.basePosition.y * uiScaleY);
-                sliderSecondaryX.track.setPosition(sliderSecondaryX.position);
-                sliderSecondaryX.label.setPosition(sliderSecondaryX.position.x, sliderSecondaryX.position.y - 40);
-                sliderSecondaryX.width = sliderSecondaryX.baseWidth * 2 * uiScaleX;
-                sliderSecondaryX.track.setSize(sf::Vector2f(sliderSecondaryX.width, 8));
-                sliderSecondaryX.updateHandlePosition();
-                
-                sliderSecondaryY.position = sf::Vector2f(sliderSecondaryY.basePosition.x * uiScaleX, 
-                                                         sliderSecondaryY.basePosition.y * uiScaleY);
-                sliderSecondaryY.track.setPosition(sliderSecondaryY.position);
-                sliderSecondaryY.label.setPosition(sliderSecondaryY.position.x, sliderSecondaryY.position.y - 40);
-                sliderSecondaryY.width = sliderSecondaryY.baseWidth * 2 * uiScaleX;
-                sliderSecondaryY.track.setSize(sf::Vector2f(sliderSecondaryY.width, 8));
-                sliderSecondaryY.updateHandlePosition();
+                for (Slider* slider : sliders) slider->layout(uiScaleX, uiScaleY);
                 
                 prevConfigButton.shape.setPosition(prevConfigButton.basePosition.x * uiScaleX, 
                                                    prevConfigButton.basePosition.y * uiScaleY);
@@ -581,28 +769,24 @@ int main() {
                     continue;
                 }
                 
-                sliderSecondaryX.handleMousePress(mousePos);
-                sliderSecondaryY.handleMousePress(mousePos);
+                for (Slider* slider : sliders) slider->handleMousePress(mousePos);
 
                 if (prevConfigButton.contains(mousePos) && currentConfigIndex > 0) {
                     currentConfigIndex--;
                     rebuildConfiguration(availableConfigs, currentConfigIndex, scene, primaryCenterX,
-                                       sliderSecondaryX, sliderSecondaryY);
+                                       sliderSecondaryX, sliderSecondaryY, panel);
                 }
                 
                 if (nextConfigButton.contains(mousePos) && currentConfigIndex < (int)availableConfigs.size() - 1) {
                     currentConfigIndex++;
                     rebuildConfiguration(availableConfigs, currentConfigIndex, scene, primaryCenterX,
-                                       sliderSecondaryX, sliderSecondaryY);
+                                       sliderSecondaryX, sliderSecondaryY, panel);
                 }
                 
                 if (loadConfigButton.contains(mousePos)) {
-                    availableConfigs = BatchOptimizer::loadResultsFromCSV(configFile);
-                    if (!availableConfigs.empty()) {
-                        currentConfigIndex = 0;
-                        rebuildConfiguration(availableConfigs, currentConfigIndex, scene, primaryCenterX,
-                                           sliderSecondaryX, sliderSecondaryY);
-                    }
+                    // Parsed in the background; applied below when it arrives
+                    resultsWatcher.requestReload();
+                    showFirstOnReload = true;
                 }
 
                 if (centerSecondaryButton.contains(mousePos)) {
@@ -686,12 +870,11 @@ int main() {
                     fineOptimizeButton.setPressed(true);
                     isOptimizing = true;
                     
-                    lastOptResult = TelescopeOptimizer::fineOptimize(
+                    lastOptResult = TelescopeOptimizer::gradientOptimize(
                         scene.mirrors, scene.camera, NUM_RAYS,
                         -50.0f, -120.0f, 120.0f,
                         sliderSecondaryX.getValue(),
-                        sliderSecondaryY.getValue(),
-                        3.0f, 0.1f, 2500
+                        sliderSecondaryY.getValue()
                     );
                     
                     sliderSecondaryX.currentVal = lastOptResult.bestSecondaryX;
@@ -707,8 +890,7 @@ int main() {
                 if (event.mouseButton.button == sf::Mouse::Right) {
                     isPanning = false;
                 }
-                sliderSecondaryX.handleMouseRelease();
-                sliderSecondaryY.handleMouseRelease();
+                for (Slider* slider : sliders) slider->handleMouseRelease();
             }
             if (event.type == sf::Event::MouseMoved) {
                 mousePos = window.mapPixelToCoords(sf::Vector2i(event.mouseMove.x, event.mouseMove.y));
@@ -718,11 +900,11 @@ int main() {
                     sf::Vector2f delta = mousePos - lastMousePos;
                     scene.offset += delta;
                     scene.baseOffset = scene.offset;
+                    scene.viewChanged = true;
                     lastMousePos = mousePos;
                 }
                 
-                sliderSecondaryX.handleMouseMove(mousePos);
-                sliderSecondaryY.handleMouseMove(mousePos);
+                for (Slider* slider : sliders) slider->handleMouseMove(mousePos);
                 
                 secXDecCoarse.setHighlight(secXDecCoarse.contains(mousePos));
                 secXIncCoarse.setHighlight(secXIncCoarse.contains(mousePos));
@@ -736,38 +918,137 @@ int main() {
             }
         }
 
-        window.clear(sf::Color(20, 20, 30));
+        ResultsUpdate resultsUpdate;
+        if (resultsWatcher.takeUpdate(resultsUpdate)) {
+            int shownRow = usingDefaultConfig ? -1 : availableConfigs[currentConfigIndex].rowIndex;
+            OpticalConfig shownBefore = availableConfigs[currentConfigIndex];
+            
+            if (resultsUpdate.replaced || usingDefaultConfig) {
+                availableConfigs = std::move(resultsUpdate.rows);
+            } else {
+                availableConfigs.insert(availableConfigs.end(),
+                                        resultsUpdate.rows.begin(), resultsUpdate.rows.end());
+            }
+            usingDefaultConfig = false;
+            
+            // Keep showing the same configuration if it is still listed
+            auto shown = std::find_if(availableConfigs.begin(), availableConfigs.end(),
+                                      [shownRow](const OpticalConfig& config) {
+                                          return config.rowIndex == shownRow;
+                                      });
+            if (showFirstOnReload && resultsUpdate.replaced) {
+                shown = availableConfigs.end();
+                showFirstOnReload = false;
+            }
+            if (shown != availableConfigs.end()) {
+                currentConfigIndex = static_cast<int>(shown - availableConfigs.begin());
+                // A rewrite can carry new values for the same row (a live
+                // batch run re-ranks, --refine changes the prescription)
+                const OpticalConfig& now = *shown;
+                bool sameValues = now.primaryDiameter == shownBefore.primaryDiameter &&
+                                  now.secondaryDiameter == shownBefore.secondaryDiameter &&
+                                  now.primaryF == shownBefore.primaryF &&
+                                  now.secondaryR == shownBefore.secondaryR &&
+                                  now.secondaryK == shownBefore.secondaryK &&
+                                  now.mirrorSeparation == shownBefore.mirrorSeparation &&
+                                  now.systemFocalLength == shownBefore.systemFocalLength &&
+                                  now.bestSecondaryX == shownBefore.bestSecondaryX &&
+                                  now.bestSecondaryY == shownBefore.bestSecondaryY;
+                if (resultsUpdate.replaced && !sameValues) {
+                    rebuildConfiguration(availableConfigs, currentConfigIndex, scene, primaryCenterX,
+                                       sliderSecondaryX, sliderSecondaryY, panel);
+                }
+            } else {
+                currentConfigIndex = 0;
+                rebuildConfiguration(availableConfigs, currentConfigIndex, scene, primaryCenterX,
+                                   sliderSecondaryX, sliderSecondaryY, panel);
+            }
+            hudChanged = true;
+        }
 
-        HyperbolicMirror* secondaryMirror = dynamic_cast<HyperbolicMirror*>(scene.mirrors[1].get());
-        if (secondaryMirror) {
-            secondaryMirror->centerX = sliderSecondaryX.getValue();
-            secondaryMirror->centerY = sliderSecondaryY.getValue();
+        // Geometry sliders reshape the existing mirrors and move the sensor in
+        // place. Primary f and the separation move the secondary's nominal
+        // position, which carries the secondary (and its X slider) along so
+        // any offset found by the optimizers is kept.
+        float nominalBefore = primaryCenterX - panel.edited.primaryF + panel.edited.mirrorSeparation;
+        if (panel.takeChanged()) {
+            ParabolicMirror* primaryMirror = dynamic_cast<ParabolicMirror*>(scene.mirrors[0].get());
+            HyperbolicMirror* secondaryMirror = dynamic_cast<HyperbolicMirror*>(scene.mirrors[1].get());
+            if (primaryMirror && secondaryMirror) {
+                ConfigBuilder::updateTelescopeFromConfig(panel.edited, *primaryMirror, *secondaryMirror);
+            }
+            float nominalAfter = primaryCenterX - panel.edited.primaryF + panel.edited.mirrorSeparation;
+            if (nominalAfter != nominalBefore) {
+                sliderSecondaryX.setValue(sliderSecondaryX.getValue() + nominalAfter - nominalBefore);
+            }
+            if (scene.camera) {
+                scene.camera->center = sf::Vector2f(primaryCenterX + panel.cameraX.getValue(),
+                                                    panel.cameraY.getValue());
+            }
+            scene.geometryChanged = true;
         }
 
-        if (scene.camera) {
-            scene.camera->clearHits();
+        // Sliders drive the secondary; any moved slider means a retrace
+        bool sliderXChanged = sliderSecondaryX.takeChanged();
+        bool sliderYChanged = sliderSecondaryY.takeChanged();
+        if (sliderXChanged || sliderYChanged) {
+            HyperbolicMirror* secondaryMirror = dynamic_cast<HyperbolicMirror*>(scene.mirrors[1].get());
+            if (secondaryMirror) {
+                secondaryMirror->centerX = sliderSecondaryX.getValue();
+                secondaryMirror->centerY = sliderSecondaryY.getValue();
+            }
+            scene.geometryChanged = true;
         }
 
-        scene.rays.clear();
-        
-        // Get primary mirror radius - subtract small epsilon to ensure all rays hit
-        float primaryRadius = (availableConfigs[currentConfigIndex].primaryDiameter / 2.0f) - 0.5f;
-        
-        for (int i = 0; i < NUM_RAYS; i++) {
-            float h = -primaryRadius + i * (2.0f * primaryRadius / (NUM_RAYS - 1));
-            Ray ray(sf::Vector2f(-50.0f, h), sf::Vector2f(1.0f, 0.0f), sf::Color::Red);
-            scene.traceRay(ray);
-            scene.rays.push_back(ray);
+        for (Button* button : {&prevConfigButton, &nextConfigButton, &loadConfigButton,
+                               &centerSecondaryButton, &optimizeButton, &fineOptimizeButton}) {
+            if (button->takeChanged()) redrawNeeded = true;
+        }
+        for (IncrementButton* button : {&secXDecCoarse, &secXIncCoarse, &secXDecFine, &secXIncFine,
+                                        &secYDecCoarse, &secYIncCoarse, &secYDecFine, &secYIncFine}) {
+            if (button->takeChanged()) redrawNeeded = true;
+        }
+
+        if (scene.geometryChanged) {
+            if (scene.camera) {
+                scene.camera->clearHits();
+            }
+
+            // Reuse last trace's storage: no allocations once capacity is warm
+            scene.rays.clear();
+            scene.pathBuffer.clear();
+            
+            // Get primary mirror radius - subtract small epsilon to ensure all rays hit
+            float primaryRadius = (panel.edited.primaryDiameter / 2.0f) - 0.5f;
+            int numRays = panel.rays();
+            
+            for (int i = 0; i < numRays; i++) {
+                float h = -primaryRadius + i * (2.0f * primaryRadius / (numRays - 1));
+                Ray ray(sf::Vector2f(-50.0f, h), sf::Vector2f(1.0f, 0.0f), sf::Color::Red,
+                        &scene.pathBuffer);
+                scene.traceRay(ray);
+                scene.rays.push_back(ray);
+            }
+
+            scene.geometryChanged = false;
+            hudChanged = true;
         }
 
+        if (scene.viewChanged || hudChanged) {
+            scene.viewChanged = false;
+            redrawNeeded = true;
+        }
+        if (!redrawNeeded) continue;
+        redrawNeeded = false;
+
+        window.clear(sf::Color(20, 20, 30));
+
         for (const auto& mirror : scene.mirrors)
             mirror->draw(window, scene.offset, scene.scale);
 
-        for (const auto& ray : scene.rays)
-            scene.drawRay(window, ray);
+        scene.drawRays(window);
 
-        sliderSecondaryX.draw(window);
-        sliderSecondaryY.draw(window);
+        for (Slider* slider : sliders) slider->draw(window);
         
         secXDecCoarse.draw(window);
         secXIncCoarse.draw(window);
@@ -787,95 +1068,105 @@ int main() {
         optimizeButton.draw(window);
         fineOptimizeButton.draw(window);
 
-        sf::Text title("Cassegrain Telescope - Config Selector", font, 34);
-        title.setFillColor(sf::Color::White);
-        title.setPosition(20, 20);
-        window.draw(title);
-
-        std::stringstream configInfo;
-        configInfo << "Config " << (currentConfigIndex + 1) << "/" << availableConfigs.size() << ": "
-                   << ConfigBuilder::getConfigSummary(availableConfigs[currentConfigIndex]);
-        sf::Text configText(configInfo.str(), font, 24);
-        configText.setFillColor(sf::Color(150, 200, 255));
-        configText.setPosition(20, 70);
-        window.draw(configText);
-
-        if (scene.camera) {
-            std::stringstream ss;
-            ss << "Hits: " << scene.camera->hitPoints.size() << "/" << scene.camera->totalRaysTraced;
-            float percentage = scene.camera->totalRaysTraced > 0 ? 
-                (100.0f * scene.camera->hitPoints.size()) / scene.camera->totalRaysTraced : 0.0f;
-            ss << " (" << std::fixed << std::setprecision(1) << percentage << "%)";
-            if (scene.camera->blockedRays > 0) ss << " | Blocked: " << scene.camera->blockedRays;
+        if (hudChanged) {
+            hud.clear();
+
+            sf::Text title("Cassegrain Telescope - Config Selector", font, 34);
+            title.setFillColor(sf::Color::White);
+            title.setPosition(20, 20);
+            hud.push_back(title);
+
+            std::stringstream configInfo;
+            configInfo << "Config " << (currentConfigIndex + 1) << "/" << availableConfigs.size() << ": "
+                       << ConfigBuilder::getConfigSummary(panel.edited);
+            sf::Text configText(configInfo.str(), font, 24);
+            configText.setFillColor(sf::Color(150, 200, 255));
+            configText.setPosition(20, 70);
+            hud.push_back(configText);
+
+            if (scene.camera) {
+                std::stringstream ss;
+                ss << "Hits: " << scene.camera->hitPoints.size() << "/" << scene.camera->totalRaysTraced;
+                float percentage = scene.camera->totalRaysTraced > 0 ? 
+                    (100.0f * scene.camera->hitPoints.size()) / scene.camera->totalRaysTraced : 0.0f;
+                ss << " (" << std::fixed << std::setprecision(1) << percentage << "%)";
+                if (scene.camera->blockedRays > 0) ss << " | Blocked: " << scene.camera->blockedRays;
             
-            sf::Text stats(ss.str(), font, 28);
-            stats.setFillColor(sf::Color::Cyan);
-            stats.setPosition(20, 110);
-            window.draw(stats);
+                sf::Text stats(ss.str(), font, 28);
+                stats.setFillColor(sf::Color::Cyan);
+                stats.setPosition(20, 110);
+                hud.push_back(stats);
             
-            if (scene.camera->hitPoints.size() >= 2) {
-                std::stringstream focusSS;
-                focusSS << "RMS: " << std::fixed << std::setprecision(3) 
-                       << scene.camera->getRMSSpotSize() << "mm | Spread: "
-                       << scene.camera->getFocusSpread() << "mm";
-                
-                sf::Text focusStats(focusSS.str(), font, 26);
-                focusStats.setFillColor(sf::Color(100, 255, 150));
-                focusStats.setPosition(20, 150);
-                window.draw(focusStats);
-            }
+                if (scene.camera->hitPoints.size() >= 2) {
+                    std::stringstream focusSS;
+                    focusSS << "RMS: " << std::fixed << std::setprecision(3) 
+                           << scene.camera->getRMSSpotSize() << "mm | Spread: "
+                           << scene.camera->getFocusSpread() << "mm";
+                
+                    sf::Text focusStats(focusSS.str(), font, 26);
+                    focusStats.setFillColor(sf::Color(100, 255, 150));
+                    focusStats.setPosition(20, 150);
+                    hud.push_back(focusStats);
+                }
             
-            std::stringstream opticalSS;
-            float effectiveFocalLength = availableConfigs[currentConfigIndex].systemFocalLength;
-            float angularResArcsec = scene.camera->getAngularResolutionArcsec(effectiveFocalLength);
-            float fovArcmin = scene.camera->getFieldOfViewArcmin(effectiveFocalLength);
+                std::stringstream opticalSS;
+                float effectiveFocalLength = panel.edited.systemFocalLength;
+                float angularResArcsec = scene.camera->getAngularResolutionArcsec(effectiveFocalLength);
+                float fovArcmin = scene.camera->getFieldOfViewArcmin(effectiveFocalLength);
             
-            opticalSS << "f_eff:" << std::fixed << std::setprecision(0) << effectiveFocalLength 
-                     << "mm | " << std::setprecision(2) << angularResArcsec << "\"/px | FOV:" 
-                     << std::setprecision(1) << fovArcmin << "×" 
-                     << (fovArcmin * scene.camera->SENSOR_HEIGHT_MM / scene.camera->SENSOR_WIDTH_MM) << "'";
+                opticalSS << "f_eff:" << std::fixed << std::setprecision(0) << effectiveFocalLength 
+                         << "mm | " << std::setprecision(2) << angularResArcsec << "\"/px | FOV:" 
+                         << std::setprecision(1) << fovArcmin << "×" 
+                         << (fovArcmin * scene.camera->SENSOR_HEIGHT_MM / scene.camera->SENSOR_WIDTH_MM) << "'";
             
-            sf::Text opticalSpec(opticalSS.str(), font, 24);
-            opticalSpec.setFillColor(sf::Color(200, 200, 255));
-            opticalSpec.setPosition(20, 190);
-            window.draw(opticalSpec);
+                sf::Text opticalSpec(opticalSS.str(), font, 24);
+                opticalSpec.setFillColor(sf::Color(200, 200, 255));
+                opticalSpec.setPosition(20, 190);
+                hud.push_back(opticalSpec);
             
-            HyperbolicMirror* secondaryMirror = dynamic_cast<HyperbolicMirror*>(scene.mirrors[1].get());
-            ParabolicMirror* primaryMirror = dynamic_cast<ParabolicMirror*>(scene.mirrors[0].get());
-            if (secondaryMirror && primaryMirror) {
-                float primaryToSecondary = std::abs(primaryMirror->centerX - secondaryMirror->centerX);
-                float secondaryToSensor = std::abs(scene.camera->center.x - secondaryMirror->centerX);
-                
-                std::stringstream distSS;
-                distSS << "Primary -> Secondary: " << std::fixed << std::setprecision(2) << primaryToSecondary 
-                       << "mm | Secondary -> Sensor: " << secondaryToSensor << "mm";
-                
-                sf::Text distText(distSS.str(), font, 24);
-                distText.setFillColor(sf::Color(255, 200, 100));
-                distText.setPosition(20, 230);
-                window.draw(distText);
+                HyperbolicMirror* secondaryMirror = dynamic_cast<HyperbolicMirror*>(scene.mirrors[1].get());
+                ParabolicMirror* primaryMirror = dynamic_cast<ParabolicMirror*>(scene.mirrors[0].get());
+                if (secondaryMirror && primaryMirror) {
+                    float primaryToSecondary = std::abs(primaryMirror->centerX - secondaryMirror->centerX);
+                    float secondaryToSensor = std::abs(scene.camera->center.x - secondaryMirror->centerX);
+                
+                    std::stringstream distSS;
+                    distSS << "Primary -> Secondary: " << std::fixed << std::setprecision(2) << primaryToSecondary 
+                           << "mm | Secondary -> Sensor: " << secondaryToSensor << "mm";
+                
+                    sf::Text distText(distSS.str(), font, 24);
+                    distText.setFillColor(sf::Color(255, 200, 100));
+                    distText.setPosition(20, 230);
+                    hud.push_back(distText);
+                }
             }
-        }
 
-        if (lastOptResult.maxHits > 0) {
-            std::stringstream ss;
-            ss << "Last Opt: X=" << std::fixed << std::setprecision(2) << lastOptResult.bestSecondaryX
-               << " Y=" << lastOptResult.bestSecondaryY << " | " << lastOptResult.maxHits << " hits ("
-               << std::setprecision(1) << lastOptResult.hitPercentage << "%) RMS:" 
-               << std::setprecision(3) << lastOptResult.focusSpread << "mm";
+            if (lastOptResult.maxHits > 0) {
+                std::stringstream ss;
+                ss << "Last Opt: X=" << std::fixed << std::setprecision(2) << lastOptResult.bestSecondaryX
+                   << " Y=" << lastOptResult.bestSecondaryY << " | " << lastOptResult.maxHits << " hits ("
+                   << std::setprecision(1) << lastOptResult.hitPercentage << "%) RMS:" 
+                   << std::setprecision(3) << lastOptResult.focusSpread << "mm";
+                if (lastOptResult.evaluations > 0) ss << " | " << lastOptResult.evaluations << " traces";
+                if (lastOptResult.mismatches > 0) ss << " | stopped: " << lastOptResult.mismatches << " rays off the gradient model";
             
-            sf::Text optStats(ss.str(), font, 22);
-            optStats.setFillColor(sf::Color(100, 255, 100));
-            optStats.setPosition(20, 270);
-            window.draw(optStats);
-        }
+                sf::Text optStats(ss.str(), font, 22);
+                optStats.setFillColor(sf::Color(100, 255, 100));
+                optStats.setPosition(20, 270);
+                hud.push_back(optStats);
+            }
+
+            if (isOptimizing) {
+                sf::Text optimizingText("Optimizing...", font, 32);
+                optimizingText.setFillColor(sf::Color::Yellow);
+                optimizingText.setPosition(1200 * uiScaleX, 850 * uiScaleY);
+                hud.push_back(optimizingText);
+            }
 
-        if (isOptimizing) {
-            sf::Text optimizingText("Optimizing...", font, 32);
-            optimizingText.setFillColor(sf::Color::Yellow);
-            optimizingText.setPosition(1200 * uiScaleX, 850 * uiScaleY);
-            window.draw(optimizingText);
+            hudChanged = false;
         }
+        for (const auto& text : hud)
+            window.draw(text);
 
         window.display();
     }
@@ -0,0 +1,75 @@
+#ifndef CHECK_FIXTURE_H
+#define CHECK_FIXTURE_H
+
+// Setup shared by the checks in tests/: sweeps over the grids' design
+// space, batch_optimize's camera, and randomly perturbed secondaries for
+// the ray-by-ray comparisons against traceToSensor.
+#include "BatchOptimizer.h"
+#include "ParameterSweep.h"
+#include "Camera.h"
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <cmath>
+
+namespace CheckFixture {
+
+// Sweep from spec lines; false (with the error on cerr) on a bad line
+inline bool makeSweep(std::initializer_list<const char*> lines, ParameterSweep& sweep) {
+    std::string error;
+    for (const char* line : lines) {
+        if (!sweep.parseLine(line, error)) {
+            std::cerr << line << ": " << error << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// The ray-level checks' sweep: 108 configurations around the grids' 8"
+// designs, with secondaries large enough to block the central rays
+inline bool makeRaySweep(ParameterSweep& sweep) {
+    return makeSweep({"primaryDiameter = 203.2", "secondaryDiameter = 35:55:10",
+                      "primaryF = 1625.6:2032:406.4", "secondaryR = -560:-440:60",
+                      "secondaryK = -2.4:-1.6:0.4", "mirrorSeparation = 330:390:30"}, sweep);
+}
+
+// batch_optimize's sensor, 40 mm behind the primary vertex
+inline CameraSensor makeCamera() {
+    return CameraSensor(sf::Vector2f(BatchOptimizer::PRIMARY_CENTER_X + 40.0f, 0.0f), 40.0f,
+                        M_PI / 2.0f, "Camera");
+}
+
+// Random setups of one configuration: the secondary anywhere in the scan
+// range, decentred and tilted, and a field angle and launch plane for the
+// rays. Odd setups launch in front of the secondary, whose back then
+// blocks the central rays. Reproducible for a given seed.
+class RandomSetups {
+public:
+    explicit RandomSetups(unsigned seed) : rng(seed), unit(-1.0f, 1.0f) {}
+
+    float field = 0.0f;   // Launch angle (rad)
+    float startX = 0.0f;  // Launch plane
+
+    void perturb(HyperbolicMirror& secondary, float nominalX, int setup) {
+        secondary.centerX = nominalX + BatchOptimizer::SCAN_HALF_RANGE * unit(rng);
+        secondary.centerY = 2.0f * unit(rng);
+        secondary.tilt = 0.01f * unit(rng);
+        field = 0.5f * static_cast<float>(M_PI) / 180.0f * unit(rng);
+        startX = setup % 2 ? nominalX - 2.0f * secondary.a - 100.0f : -50.0f;
+    }
+
+    // A ray of the current setup at a random height over the primary
+    Ray ray(const OpticalConfig& config) {
+        float h = config.primaryDiameter / 2.0f * unit(rng);
+        return Ray(sf::Vector2f(startX, h), sf::Vector2f(std::cos(field), std::sin(field)));
+    }
+
+private:
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> unit;
+};
+
+}  // namespace CheckFixture
+
+#endif // CHECK_FIXTURE_H
@@ -0,0 +1,114 @@
+// Interpreted prescriptions against the generic closest-hit tracer. The
+// non-sequential prescription must match traceToSensor for any bounce
+// limit, and the interpreted sequential Cassegrain prescription wherever
+// matchCassegrain accepts the scene (check_sequential_path covers the
+// compiled path). Finally a small batch must rank identically in both
+// trace modes.
+#include "CheckFixture.h"
+#include "Prescription.h"
+#include <iostream>
+
+namespace {
+
+long long mismatches = 0;
+
+void compare(const char* tracer, TraceOutcome actual, const Ray& ray, sf::Vector2f hit,
+             TraceOutcome expected, const Ray& reference, sf::Vector2f referenceHit) {
+    bool same = actual == expected && ray.bounces == reference.bounces &&
+                (expected != TraceOutcome::Hit || hit == referenceHit);
+    if (!same && mismatches++ < 10) {
+        std::cerr << tracer << ": outcome " << static_cast<int>(actual) << "/" << static_cast<int>(expected)
+                  << ", bounces " << ray.bounces << "/" << reference.bounces << std::endl;
+    }
+}
+
+}  // namespace
+
+int main() {
+    ParameterSweep sweep;
+    if (!CheckFixture::makeRaySweep(sweep)) return 1;
+    CameraSensor camera = CheckFixture::makeCamera();
+    CheckFixture::RandomSetups setups(54321);
+
+    const int SETUPS_PER_CONFIG = 20;
+    const int RAYS_PER_SETUP = 250;
+    long long rays = 0;
+
+    for (size_t row = 0; row < sweep.size(); row++) {
+        OpticalConfig config = sweep.at(row);
+        std::vector<std::unique_ptr<Mirror>> mirrors;
+        BatchOptimizer::buildSystem(config, mirrors);
+        auto* primary = dynamic_cast<ParabolicMirror*>(mirrors[0].get());
+        auto* secondary = dynamic_cast<HyperbolicMirror*>(mirrors[1].get());
+        float nominalX = secondary->centerX;
+
+        for (int setup = 0; setup < SETUPS_PER_CONFIG; setup++) {
+            setups.perturb(*secondary, nominalX, setup);
+            int maxBounces = 1 + setup % 5;
+
+            PrescriptionTracer nonSequential(OpticalPrescription::nonSequential(mirrors, &camera), maxBounces);
+
+            // The Cassegrain entries with a finite bounce window, which the
+            // tracer interprets instead of compiling
+            const int OPEN = 1000;
+            OpticalPrescription entries;
+            entries.add(secondary, SurfaceRole::Obstruction, -1, 0, OPEN);
+            entries.add(primary, SurfaceRole::Mirror, -1, 0, OPEN);
+            entries.add(secondary, SurfaceRole::Mirror, -1, 0, OPEN);
+            entries.add(&camera, SurfaceRole::Detector, -1, 0, OPEN);
+            PrescriptionTracer interpreted(entries, maxBounces);
+
+            const ParabolicMirror* matchedPrimary = nullptr;
+            const HyperbolicMirror* matchedSecondary = nullptr;
+            bool cassegrain = TelescopeOptimizer::matchCassegrain(mirrors, &camera, maxBounces,
+                                                                  matchedPrimary, matchedSecondary);
+            if (nonSequential.isCompiled() || interpreted.isCompiled()) {
+                std::cerr << "row " << row << ": prescription compiled instead of interpreted" << std::endl;
+                return 1;
+            }
+
+            for (int i = 0; i < RAYS_PER_SETUP; i++) {
+                Ray reference = setups.ray(config);
+                Ray ray = reference;
+                Ray sequentialRay = reference;
+                sf::Vector2f referenceHit;
+                TraceOutcome expected = TelescopeOptimizer::traceToSensor(reference, mirrors, &camera,
+                                                                          maxBounces, referenceHit);
+
+                sf::Vector2f hit;
+                compare("non-sequential", nonSequential.trace(ray, hit), ray, hit,
+                        expected, reference, referenceHit);
+                if (cassegrain) {
+                    compare("interpreted sequential", interpreted.trace(sequentialRay, hit), sequentialRay, hit,
+                            expected, reference, referenceHit);
+                }
+                rays++;
+            }
+        }
+    }
+
+    // Whole batch in both modes
+    ProgressSettings progress;
+    progress.intervalSeconds = 0.0;
+    TraceOptions sequential;
+    TraceOptions searched;
+    searched.traceMode = TraceMode::NonSequential;
+    std::vector<BatchResult> expected = BatchOptimizer::optimizeSweep(
+        sweep, &camera, 200, -50.0f, -120.0f, 120.0f, 4, 10, sequential, "", progress);
+    std::vector<BatchResult> actual = BatchOptimizer::optimizeSweep(
+        sweep, &camera, 200, -50.0f, -120.0f, 120.0f, 4, 10, searched, "", progress);
+    bool batchSame = actual.size() == expected.size();
+    for (size_t i = 0; batchSame && i < actual.size(); i++) {
+        batchSame = actual[i].config.rowIndex == expected[i].config.rowIndex &&
+                    actual[i].score == expected[i].score &&
+                    actual[i].bestSecondaryX == expected[i].bestSecondaryX;
+    }
+    if (!batchSame) {
+        std::cerr << "batch results differ between sequential and non-sequential tracing" << std::endl;
+        mismatches++;
+    }
+
+    std::cout << "check_prescription: " << (mismatches ? "FAILED" : "passed") << " (" << rays
+              << " rays, " << mismatches << " mismatches)" << std::endl;
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+// Screened sweep against the full trace: --screen is approximate (the
+// surrogate bound is a heuristic), so this checks on a fixed sweep that it
+// still returns the same top-N table as the unscreened run.
+#include "CheckFixture.h"
+#include <iostream>
+
+int main() {
+    ParameterSweep sweep;
+    if (!CheckFixture::makeSweep({"primaryDiameter = 203.2", "secondaryDiameter = 35",
+                                  "primaryF = 1625.6:2032:203.2", "secondaryR = -560:-440:30",
+                                  "secondaryK = -2.4:-1.6:0.2", "mirrorSeparation = 330:390:15"}, sweep)) {
+        return 1;
+    }
+
+    const int topN = 10;
+    const int numRays = 200;
+    ProgressSettings progress;
+    progress.intervalSeconds = 0.0;
+
+    TraceOptions full;
+    TraceOptions screened;
+    screened.screening.enabled = true;
+    screened.screening.initialSamples = 64;
+    screened.screening.batchSize = 16;
+
+    CameraSensor camera = CheckFixture::makeCamera();
+    std::vector<BatchResult> expected = BatchOptimizer::optimizeSweep(
+        sweep, &camera, numRays, -50.0f, -120.0f, 120.0f, 4, topN, full, "", progress);
+    std::vector<BatchResult> actual = BatchOptimizer::optimizeSweep(
+        sweep, &camera, numRays, -50.0f, -120.0f, 120.0f, 4, topN, screened, "", progress);
+
+    int mismatches = 0;
+    if (actual.size() != expected.size()) {
+        std::cerr << "top-N size " << actual.size() << ", expected " << expected.size() << std::endl;
+        mismatches++;
+    }
+    for (size_t i = 0; i < std::min(actual.size(), expected.size()); i++) {
+        if (actual[i].config.rowIndex != expected[i].config.rowIndex ||
+            actual[i].score != expected[i].score) {
+            std::cerr << "rank " << (i + 1) << ": row " << actual[i].config.rowIndex
+                      << " score " << actual[i].score << ", expected row "
+                      << expected[i].config.rowIndex << " score " << expected[i].score << std::endl;
+            mismatches++;
+        }
+    }
+
+    std::cout << "check_screening: " << (mismatches ? "FAILED" : "passed") << " ("
+              << sweep.size() << " rows, top " << topN << ")" << std::endl;
+    return mismatches ? 1 : 0;
+}
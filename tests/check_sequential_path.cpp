@@ -0,0 +1,66 @@
+// Compiled CassegrainPath against the generic closest-hit tracer: for
+// random secondary shifts and tilts, field angles, launch planes and
+// heights (blocked rays included), every ray must end the same way, after
+// the same number of reflections, at the same point.
+#include "CheckFixture.h"
+#include "SequentialTracer.h"
+#include <iostream>
+
+int main() {
+    ParameterSweep sweep;
+    if (!CheckFixture::makeRaySweep(sweep)) return 1;
+    CameraSensor camera = CheckFixture::makeCamera();
+    CheckFixture::RandomSetups setups(12345);
+
+    const int SETUPS_PER_CONFIG = 20;
+    const int RAYS_PER_SETUP = 500;
+    long long rays = 0, hits = 0, blocked = 0, mismatches = 0;
+
+    for (size_t row = 0; row < sweep.size(); row++) {
+        OpticalConfig config = sweep.at(row);
+        std::vector<std::unique_ptr<Mirror>> mirrors;
+        BatchOptimizer::buildSystem(config, mirrors);
+        auto* secondary = dynamic_cast<HyperbolicMirror*>(mirrors[1].get());
+        float nominalX = secondary->centerX;
+
+        for (int setup = 0; setup < SETUPS_PER_CONFIG; setup++) {
+            setups.perturb(*secondary, nominalX, setup);
+            int maxBounces = 3 + setup % 3;
+
+            const ParabolicMirror* primary = nullptr;
+            const HyperbolicMirror* matched = nullptr;
+            if (!TelescopeOptimizer::matchCassegrain(mirrors, &camera, maxBounces, primary, matched)) {
+                std::cerr << "row " << row << ": scene not recognised as Cassegrain" << std::endl;
+                return 1;
+            }
+            CassegrainPath path(Obstruction<HyperbolicMirror>{*matched}, Reflection<ParabolicMirror>{*primary},
+                                Reflection<HyperbolicMirror>{*matched}, Detector{camera});
+
+            for (int i = 0; i < RAYS_PER_SETUP; i++) {
+                Ray generic = setups.ray(config);
+                Ray compiled = generic;
+                float h = generic.origin.y;
+                sf::Vector2f genericHit, compiledHit;
+                TraceOutcome expected = TelescopeOptimizer::traceToSensor(generic, mirrors, &camera,
+                                                                          maxBounces, genericHit);
+                TraceOutcome actual = path.trace(compiled, compiledHit);
+
+                bool same = actual == expected && compiled.bounces == generic.bounces &&
+                            (expected != TraceOutcome::Hit || compiledHit == genericHit);
+                if (!same && mismatches++ < 10) {
+                    std::cerr << "row " << row << " setup " << setup << " h " << h
+                              << ": outcome " << static_cast<int>(actual) << "/" << static_cast<int>(expected)
+                              << ", bounces " << compiled.bounces << "/" << generic.bounces << std::endl;
+                }
+                rays++;
+                hits += expected == TraceOutcome::Hit;
+                blocked += expected == TraceOutcome::Blocked;
+            }
+        }
+    }
+
+    std::cout << "check_sequential_path: " << (mismatches ? "FAILED" : "passed") << " (" << rays
+              << " rays, " << hits << " hits, " << blocked << " blocked, " << mismatches
+              << " mismatches)" << std::endl;
+    return mismatches ? 1 : 0;
+}